@@ -1,6 +1,7 @@
 #include "BubbleLevel.hpp"
 #include "data_path.hpp"
 #include "LitColorTextureProgram.hpp"
+#include "read_write_chunk.hpp"
 
 #include <unordered_set>
 #include <unordered_map>
@@ -15,57 +16,165 @@ GLuint bubble_meshes_for_lit_color_texture_program = 0;
 
 //Load the meshes used in Bubble 3D levels:
 Load< MeshBuffer > bubble_meshes(LoadTagDefault, []() -> MeshBuffer * {
-	MeshBuffer *ret = new MeshBuffer(data_path("bubble-parts.pnct"));
+	MeshBuffer *ret = new MeshBuffer(data_path("bubble-parts.pnct"), MeshBuffer::CompactVertices);
 
 	//Build vertex array object for the program we're using to shade these meshes:
 	bubble_meshes_for_lit_color_texture_program = ret->make_vao_for_program(lit_color_texture_program->program);
 
-	//key objects:
-	mesh_Bullet = &ret->lookup("Bullet");
-	mesh_Bubble = &ret->lookup("Bubble");
-	mesh_Arena = &ret->lookup("Arena");
-
 	return ret;
 });
 
+//key objects:
+// (looked up once the file has been read, so it can be read alongside the other resources)
+Load< void > bubble_meshes_lookup(LoadTagLate, []() {
+	mesh_Bullet = &bubble_meshes->lookup("Bullet");
+	mesh_Bubble = &bubble_meshes->lookup("Bubble");
+	mesh_Arena = &bubble_meshes->lookup("Arena");
+});
+
 Load< std::list< BubbleLevel > > bubble_levels(LoadTagLate, []() -> std::list< BubbleLevel > * {
 	std::list< BubbleLevel > *ret = new std::list< BubbleLevel >();
-	ret->emplace_back(data_path("bubble-level-1.scene"));
+	ret->emplace_back(data_path("bubble-level-1.level"));
 	return ret;
 });
 
 
 //-------- BubbleLevel ---------
 
-BubbleLevel::BubbleLevel(std::string const &scene_file) {
-  auto load_fn = [this](Scene &, Transform *transform, std::string const &mesh_name){
-    Mesh const *mesh = &bubble_meshes->lookup(mesh_name);
+BubbleLevel::BubbleLevel(std::string const &level_file) {
+	//(throws if the file can't be opened)
+	MappedFile file(level_file);
+	size_t offset = 0;
+
+	ChunkSpan< char > names;
+	read_chunk(file, &offset, "str0", &names);
+
+	ChunkSpan< Cooked::Transform > hierarchy;
+	read_chunk(file, &offset, "xfh0", &hierarchy);
+
+	ChunkSpan< Cooked::Range > ranges;
+	read_chunk(file, &offset, "rng0", &ranges);
+
+	ChunkSpan< Cooked::Drawable > cooked_drawables;
+	read_chunk(file, &offset, "drw0", &cooked_drawables);
 
-    drawables.emplace_back(transform);
-    Drawable::Pipeline &pipeline = drawables.back().pipeline;
+	ChunkSpan< Cooked::Collider > cooked_colliders;
+	read_chunk(file, &offset, "col0", &cooked_colliders);
 
-    //set up drawable to draw mesh from buffer:
-    pipeline = lit_color_texture_program_pipeline;
-    pipeline.vao = bubble_meshes_for_lit_color_texture_program;
-    pipeline.type = mesh->type;
-    pipeline.start = mesh->start;
-    pipeline.count = mesh->count;
+	ChunkSpan< glm::vec3 > collision_positions;
+	read_chunk(file, &offset, "ctp0", &collision_positions);
 
-  };
-	//Load scene (using Scene::load function), building proper associations as needed:
-	load(scene_file, load_fn);
+	ChunkSpan< uint32_t > collision_indices;
+	read_chunk(file, &offset, "cti0", &collision_indices);
+
+	if (offset != file.size) {
+		std::cerr << "WARNING: trailing data in level file '" << level_file << "'" << std::endl;
+	}
+
+	//--------------------------------
+	//Now that file is loaded, create transforms for hierarchy entries:
+	// (this is the same as what Scene::load does)
+
+	std::vector< Transform * > hierarchy_transforms;
+	hierarchy_transforms.reserve(hierarchy.size());
+
+	for (auto const &h : hierarchy) {
+		transforms.emplace_back();
+		Transform *t = &transforms.back();
+		if (h.parent != -1U) {
+			if (h.parent >= hierarchy_transforms.size()) {
+				throw std::runtime_error("level file '" + level_file + "' did not contain transforms in topological-sort order.");
+			}
+			t->parent = hierarchy_transforms[h.parent];
+		}
+
+		if (h.name_begin <= h.name_end && h.name_end <= names.size()) {
+			t->name = std::string(names.begin() + h.name_begin, names.begin() + h.name_end);
+		} else {
+			throw std::runtime_error("level file '" + level_file + "' contains hierarchy entry with invalid name indices");
+		}
+
+		t->position = h.position;
+		t->rotation = h.rotation;
+		t->scale = h.scale;
+
+		hierarchy_transforms.emplace_back(t);
+	}
+
+	//vertex ranges were resolved when cooking, so just check they still fit the mesh buffer:
+	std::vector< Mesh > range_meshes;
+	range_meshes.reserve(ranges.size());
+	for (auto const &r : ranges) {
+		if (!(r.type == GL_TRIANGLES && r.start <= r.start + r.count && r.start + r.count <= bubble_meshes->index_count)) {
+			throw std::runtime_error("level file '" + level_file + "' contains a mesh range that doesn't fit the mesh buffer (stale level file?)");
+		}
+		range_meshes.emplace_back();
+		Mesh &mesh = range_meshes.back();
+		mesh.type = r.type;
+		mesh.start = r.start;
+		mesh.count = r.count;
+		mesh.index_type = bubble_meshes->index_type;
+		mesh.position_to_object = bubble_meshes->position_to_object;
+		mesh.min = r.min;
+		mesh.max = r.max;
+	}
+
+	for (auto const &d : cooked_drawables) {
+		if (d.transform >= hierarchy_transforms.size() || d.range >= range_meshes.size()) {
+			throw std::runtime_error("level file '" + level_file + "' contains drawable with invalid transform or range index");
+		}
+		if (d.pipeline != Cooked::PipelineLitColorTexture) {
+			throw std::runtime_error("level file '" + level_file + "' contains drawable with unknown pipeline (" + std::to_string(d.pipeline) + ")");
+		}
+		Mesh const &mesh = range_meshes[d.range];
+
+		drawables.emplace_back(hierarchy_transforms[d.transform]);
+		Drawable::Pipeline &pipeline = drawables.back().pipeline;
+
+		//set up drawable to draw mesh from buffer:
+		pipeline = lit_color_texture_program_pipeline;
+		pipeline.vao = bubble_meshes_for_lit_color_texture_program;
+		pipeline.type = mesh.type;
+		pipeline.start = mesh.start;
+		pipeline.count = mesh.count;
+		pipeline.index_type = mesh.index_type;
+		pipeline.position_to_object = mesh.position_to_object;
+	}
+
+	mesh_colliders.reserve(cooked_colliders.size());
+	for (auto const &c : cooked_colliders) {
+		if (c.transform >= hierarchy_transforms.size() || c.range >= range_meshes.size()) {
+			throw std::runtime_error("level file '" + level_file + "' contains collider with invalid transform or range index");
+		}
+		mesh_colliders.emplace_back(hierarchy_transforms[c.transform], range_meshes[c.range], *bubble_meshes);
+	}
+
+	{ //check and index collision triangles:
+		if (collision_indices.size() % 3 != 0) {
+			throw std::runtime_error("level file '" + level_file + "' has a partial collision triangle");
+		}
+		for (auto i : collision_indices) {
+			if (i >= collision_positions.size()) {
+				throw std::runtime_error("level file '" + level_file + "' has a collision triangle with invalid position index");
+			}
+		}
+		collision.build(
+			std::vector< glm::vec3 >(collision_positions.begin(), collision_positions.end()),
+			std::vector< uint32_t >(collision_indices.begin(), collision_indices.end())
+		);
+	}
 
 	//Create player camera:
-  player = PlayerCam();
+	player = PlayerCam();
 	transforms.emplace_back();
-  player.transform = &transforms.back();
+	player.transform = &transforms.back();
 	cameras.emplace_back(&transforms.back());
 	player.camera = &cameras.back();
 	player.camera->transform = &transforms.back();
 
 	player.camera->fovy = 60.0f / 180.0f * 3.1415926f;
 	player.camera->near = 0.05f;
-  player.camera->transform->position.z = 2.0f;
+	player.camera->transform->position.z = 2.0f;
 
 }
 
@@ -121,6 +230,14 @@ BubbleLevel &BubbleLevel::operator=(BubbleLevel const &other) {
 		l.transform = transform_to_transform.at(l.transform);
 	}
 
+	//---- level-specific stuff ----
+	mesh_colliders = other.mesh_colliders;
+	for (auto &c : mesh_colliders) {
+		c.transform = transform_to_transform.at(c.transform);
+	}
+
+	collision = other.collision;
+
   /* Don't copy bullets
 	bullets = other.bullets;
   */
@@ -145,6 +262,9 @@ BubbleLevel::Bullet::Bullet(BubbleLevel &lvl, glm::vec3 pos, glm::vec3 vel_) {
   pipeline.type = mesh_Bullet->type;
   pipeline.start = mesh_Bullet->start;
   pipeline.count = mesh_Bullet->count;
+  pipeline.index_type = mesh_Bullet->index_type;
+  pipeline.position_to_object = mesh_Bullet->position_to_object;
+  lvl.drawables.front().mesh = mesh_Bullet; //(for level of detail)
 
 }
 
@@ -168,5 +288,8 @@ BubbleLevel::Bubble::Bubble(BubbleLevel &lvl, glm::vec3 pos, glm::vec3 vel_, uin
   pipeline.type = mesh_Bubble->type;
   pipeline.start = mesh_Bubble->start;
   pipeline.count = mesh_Bubble->count;
+  pipeline.index_type = mesh_Bubble->index_type;
+  pipeline.position_to_object = mesh_Bubble->position_to_object;
+  lvl.drawables.front().mesh = mesh_Bubble; //(for level of detail)
 
 }
@@ -7,6 +7,7 @@
 
 #include "Scene.hpp"
 #include "Mesh.hpp"
+#include "CollisionWorld.hpp"
 #include "Load.hpp"
 
 struct BubbleLevel;
@@ -15,9 +16,9 @@ struct BubbleLevel;
 extern Load< std::list< BubbleLevel > > bubble_levels;
 
 struct BubbleLevel : Scene {
-	//Build from a scene:
-	//  note: will throw on loading failure, or if certain critical objects don't appear
-	BubbleLevel(std::string const &scene_file);
+	//Build from a cooked level (see 'Cooked', below):
+	//  note: will throw on loading failure
+	BubbleLevel(std::string const &level_file);
 
 	//Copy constructor:
 	//  used to copy a pristine, just-loaded level to a level that is being played
@@ -27,11 +28,55 @@ struct BubbleLevel : Scene {
 	// copy constructor actually just uses this = operator:
 	BubbleLevel &operator=(BubbleLevel const &);
 
+	//Cooked levels ('.level' files) are built offline by 'cook-level' from a '.scene'
+	// and 'bubble-parts.pnct'. Mesh names are already resolved to vertex ranges and
+	// collider triangles already baked into world space, so loading is one pass over the file:
+	struct Cooked {
+		//'str0' chunk: transform names
+		//'xfh0' chunk: transform hierarchy (same layout as in '.scene' files)
+		struct Transform {
+			uint32_t parent;
+			uint32_t name_begin;
+			uint32_t name_end;
+			glm::vec3 position;
+			glm::quat rotation;
+			glm::vec3 scale;
+		};
+		static_assert(sizeof(Transform) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "Cooked::Transform is packed.");
+		//'rng0' chunk: index ranges (in bubble-parts.pnct, as indexed by MeshBuffer) of meshes used by the level
+		struct Range {
+			uint32_t type; //GL_TRIANGLES
+			uint32_t start;
+			uint32_t count;
+			glm::vec3 min, max;
+		};
+		static_assert(sizeof(Range) == 4 + 4 + 4 + 4*3 + 4*3, "Cooked::Range is packed.");
+		//'drw0' chunk: drawables
+		struct Drawable {
+			uint32_t transform;
+			uint32_t range;
+			uint32_t pipeline; //one of the Pipeline* values below
+		};
+		static_assert(sizeof(Drawable) == 4 + 4 + 4, "Cooked::Drawable is packed.");
+		//'col0' chunk: static colliders
+		struct Collider {
+			uint32_t transform;
+			uint32_t range;
+		};
+		static_assert(sizeof(Collider) == 4 + 4, "Cooked::Collider is packed.");
+		//'ctp0' chunk: glm::vec3 world-space positions of the colliders' triangles
+		//'cti0' chunk: uint32_t indices into 'ctp0', three per triangle
+
+		enum : uint32_t {
+			PipelineLitColorTexture = 0, //lit_color_texture_program with bubble_meshes
+		};
+	};
+
 	//Solid parts of level are tracked as MeshColliders:
 	struct MeshCollider {
-		MeshCollider(Scene::Transform *transform_, Mesh const &mesh_, MeshBuffer const &buffer_) : transform(transform_), mesh(&mesh_), buffer(&buffer_) { }
+		MeshCollider(Scene::Transform *transform_, Mesh const &mesh_, MeshBuffer const &buffer_) : transform(transform_), mesh(mesh_), buffer(&buffer_) { }
 		Scene::Transform *transform;
-		Mesh const *mesh;
+		Mesh mesh; //held by value, since cooked ranges don't live in buffer's lookup table
 		MeshBuffer const *buffer;
 	};
 
@@ -67,6 +112,9 @@ struct BubbleLevel : Scene {
   } arena_bounds;
 
 	//Additional information for things in the level:
+	std::vector< MeshCollider > mesh_colliders;
+	//...the colliders' triangles (baked into world space when cooking), for collision queries:
+	CollisionWorld collision;
 	std::list< Bubble > bubbles;
   std::list< Bullet > bullets;
 	PlayerCam player;
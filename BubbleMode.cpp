@@ -22,6 +22,8 @@ Load< SpriteAtlas > trade_font_atlas(LoadTagDefault, []() -> SpriteAtlas const *
 });
 
 BubbleMode::BubbleMode(BubbleLevel const &level_) : start(level_), level(level_) {
+	//bubbles and bullets are spawned at the front of the drawables list, so sort to get arena overdraw under control:
+	level.sort_front_to_back = true;
 	restart();
 }
 
@@ -155,6 +157,25 @@ void BubbleMode::update(float elapsed) {
       b.vel.z = -0.98f * b.vel.z;
     }
   }
+  // (also bounce off the level's solid geometry, checking all bubbles at once)
+  {
+    sweeps.clear();
+    for (BubbleLevel::Bubble const &b : level.bubbles) {
+      sweeps.emplace_back();
+      sweeps.back().from = b.transform.position;
+      sweeps.back().to = b.transform.position + b.vel;
+      sweeps.back().radius = b.transform.scale.x;
+    }
+    level.collision.sweep(sweeps, &hits);
+    auto hit = hits.begin();
+    for (BubbleLevel::Bubble &b : level.bubbles) {
+      float d = glm::dot(b.vel, hit->out);
+      if ((hit->triangle != -1U || hit->box != -1U) && d < 0.0f) {
+        b.vel -= (1.0f + 0.98f) * d * hit->out;
+      }
+      ++hit;
+    }
+  }
 
   // 5. Update bubble-bubble collisions
 
@@ -175,7 +196,7 @@ void BubbleMode::update(float elapsed) {
           continue;
         }
 
-        float t;
+        float t = 1.0f;
         glm::vec3 at;
         glm::vec3 out;
 
@@ -217,8 +238,27 @@ void BubbleMode::update(float elapsed) {
   // 7. Update bubble-player collisions
 
   // 8. Update player position
-
-  level.player.transform->position += level.player.vel;
+  // (sliding along level geometry instead of passing through it)
+  {
+    glm::vec3 &position = level.player.transform->position;
+    glm::vec3 move = level.player.vel;
+    for (uint32_t iter = 0; iter < 4; ++iter) {
+      CollisionWorld::Sweep sweep;
+      sweep.from = position;
+      sweep.to = position + move;
+      sweep.radius = player_radius;
+      CollisionWorld::Hit hit;
+      if (!level.collision.sweep(sweep, &hit)) {
+        position += move;
+        break;
+      }
+      position += hit.t * move;
+      move *= 1.0f - hit.t;
+      //remove the parts of the remaining motion and of the velocity that go into the surface:
+      move -= std::min(0.0f, glm::dot(move, hit.out)) * hit.out;
+      level.player.vel -= std::min(0.0f, glm::dot(level.player.vel, hit.out)) * hit.out;
+    }
+  }
 
   // 9. Update player-wall collisions
 
@@ -254,11 +294,25 @@ void BubbleMode::update(float elapsed) {
   }
 
   // 11. Update bullet positions, bullet-wall collisions
+  // (bullets that hit level geometry are removed, as are those that leave the arena)
+
+  sweeps.clear();
+  for (BubbleLevel::Bullet const &bl : level.bullets) {
+    sweeps.emplace_back();
+    sweeps.back().from = bl.transform.position;
+    sweeps.back().to = bl.transform.position + bl.vel;
+    sweeps.back().radius = 0.4f;
+  }
+  level.collision.sweep(sweeps, &hits);
 
+  auto hit = hits.begin();
   auto bl_it = level.bullets.begin();
   while (bl_it != level.bullets.end()) {
+    bool hit_level = (hit->triangle != -1U || hit->box != -1U);
+    ++hit;
     bl_it->transform.position += bl_it->vel;
-    if (bl_it->transform.position.x < level.arena_bounds.min.x ||
+    if (hit_level ||
+      bl_it->transform.position.x < level.arena_bounds.min.x ||
       bl_it->transform.position.x > level.arena_bounds.max.x ||
       bl_it->transform.position.y < level.arena_bounds.min.y ||
       bl_it->transform.position.y > level.arena_bounds.max.y
@@ -49,4 +49,11 @@ struct BubbleMode : Mode {
 
   float gravity = -0.2f;
 
+	//player's collision radius (vs level geometry):
+	float player_radius = 0.5f;
+
+	//swept-sphere queries against level.collision (kept to reuse storage):
+	std::vector< CollisionWorld::Sweep > sweeps;
+	std::vector< CollisionWorld::Hit > hits;
+
 };
@@ -0,0 +1,211 @@
+#include "CollisionWorld.hpp"
+
+#include "Parallel.hpp"
+
+#include <initializer_list>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <cassert>
+
+void CollisionWorld::build(std::vector< glm::vec3 > const &positions_, std::vector< uint32_t > const &indices_, std::vector< CollisionBox > const &boxes_) {
+	positions = positions_;
+	indices = indices_;
+
+	triangles.clear();
+	triangles.reserve(indices.size() / 3);
+	for (uint32_t v = 0; v + 2 < indices.size(); v += 3) {
+		triangles.emplace_back(make_collision_triangle(positions[indices[v+0]], positions[indices[v+1]], positions[indices[v+2]]));
+	}
+	mark_convex_features(&triangles);
+
+	bvh = TriangleBVH(positions, indices, 0, uint32_t(indices.size()));
+
+	boxes = boxes_;
+	std::vector< glm::vec3 > box_corners;
+	std::vector< uint32_t > box_indices;
+	box_corners.reserve(2 * boxes.size());
+	box_indices.reserve(3 * boxes.size());
+	for (auto const &box : boxes) {
+		glm::vec3 radius = glm::abs(box.axes[0]) * box.half_extents.x + glm::abs(box.axes[1]) * box.half_extents.y + glm::abs(box.axes[2]) * box.half_extents.z;
+		box_indices.insert(box_indices.end(), { uint32_t(box_corners.size()), uint32_t(box_corners.size()) + 1, uint32_t(box_corners.size()) });
+		box_corners.emplace_back(box.center - radius);
+		box_corners.emplace_back(box.center + radius);
+	}
+	box_bvh = TriangleBVH(box_corners, box_indices, 0, uint32_t(box_indices.size()));
+}
+
+namespace {
+
+//candidate triangles for one query (kept per-thread to reuse storage):
+struct Scratch {
+	PackedTriangles packed;
+	std::vector< uint32_t > ids;
+	std::vector< uint32_t > box_ids;
+	std::vector< TriangleBVH::Node const * > leaves;
+	std::vector< TriangleBVH::Node const * > box_leaves;
+};
+thread_local Scratch scratch;
+
+void sweep_bounds(CollisionWorld::Sweep const &query, glm::vec3 *min, glm::vec3 *max) {
+	*min = glm::min(query.from, query.to) - glm::vec3(query.radius);
+	*max = glm::max(query.from, query.to) + glm::vec3(query.radius);
+}
+
+bool overlaps(TriangleBVH::Node const &node, glm::vec3 const &min, glm::vec3 const &max) {
+	return !(node.max.x < min.x || node.min.x > max.x
+	      || node.max.y < min.y || node.min.y > max.y
+	      || node.max.z < min.z || node.min.z > max.z);
+}
+
+void push_leaf(CollisionWorld const &world, TriangleBVH::Node const &leaf, PackedTriangles *packed, std::vector< uint32_t > *ids) {
+	for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) {
+		uint32_t triangle = world.bvh.triangles[i] / 3;
+		packed->push_back(world.triangles[triangle]);
+		if (ids) ids->emplace_back(triangle);
+	}
+}
+
+void push_box_leaf(CollisionWorld const &world, TriangleBVH::Node const &leaf, std::vector< uint32_t > *box_ids) {
+	for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) {
+		box_ids->emplace_back(world.box_bvh.triangles[i] / 3);
+	}
+}
+
+//test a sweep against its gathered candidates:
+bool test_candidates(CollisionWorld const &world, CollisionWorld::Sweep const &query, Scratch const &candidates, CollisionWorld::Hit *hit) {
+	CollisionWorld::Hit result;
+	uint32_t index = collide_swept_sphere_vs_triangles(query.from, query.to, query.radius, candidates.packed, &result.t, &result.at, &result.out);
+	if (index != -1U) result.triangle = candidates.ids[index];
+	for (uint32_t box : candidates.box_ids) {
+		if (collide_swept_sphere_vs_box(query.from, query.to, query.radius, world.boxes[box], &result.t, &result.at, &result.out)) {
+			result.triangle = -1U;
+			result.box = box;
+		}
+	}
+	*hit = result;
+	return result.triangle != -1U || result.box != -1U;
+}
+
+//spread the low 10 bits of x out to every third bit:
+uint32_t spread_bits(uint32_t x) {
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+} //unnamed namespace
+
+void CollisionWorld::gather(glm::vec3 const &min, glm::vec3 const &max, PackedTriangles *packed, std::vector< uint32_t > *ids) const {
+	assert(packed);
+	bvh.for_each_overlapping_leaf(min, max, [&](TriangleBVH::Node const &leaf) {
+		push_leaf(*this, leaf, packed, ids);
+	});
+}
+
+void CollisionWorld::gather_boxes(glm::vec3 const &min, glm::vec3 const &max, std::vector< uint32_t > *box_ids) const {
+	assert(box_ids);
+	box_bvh.for_each_overlapping_leaf(min, max, [&](TriangleBVH::Node const &leaf) {
+		push_box_leaf(*this, leaf, box_ids);
+	});
+}
+
+bool CollisionWorld::sweep(Sweep const &query, Hit *hit) const {
+	assert(hit);
+	glm::vec3 min, max;
+	sweep_bounds(query, &min, &max);
+	scratch.packed.clear();
+	scratch.ids.clear();
+	gather(min, max, &scratch.packed, &scratch.ids);
+	scratch.box_ids.clear();
+	gather_boxes(min, max, &scratch.box_ids);
+	return test_candidates(*this, query, scratch, hit);
+}
+
+bool CollisionWorld::ray(Ray const &query, Hit *hit) const {
+	Sweep as_sweep;
+	as_sweep.from = query.from;
+	as_sweep.to = query.to;
+	return sweep(as_sweep, hit);
+}
+
+void CollisionWorld::sweep(std::vector< Sweep > const &queries, std::vector< Hit > *hits_) const {
+	assert(hits_);
+	auto &hits = *hits_;
+	hits.assign(queries.size(), Hit());
+	if (queries.empty() || (bvh.empty() && box_bvh.empty())) return;
+
+	//order queries along a Morton curve through the world's bounds, so each group is compact:
+	glm::vec3 world_min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 world_max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (TriangleBVH const *tree : {&bvh, &box_bvh}) {
+		if (tree->empty()) continue;
+		world_min = glm::min(world_min, tree->nodes[0].min);
+		world_max = glm::max(world_max, tree->nodes[0].max);
+	}
+	glm::vec3 scale = 1023.0f / glm::max(world_max - world_min, glm::vec3(1e-6f));
+	std::vector< std::pair< uint32_t, uint32_t > > order; //(code, query index)
+	order.reserve(queries.size());
+	for (uint32_t q = 0; q < queries.size(); ++q) {
+		glm::vec3 cell = glm::clamp((0.5f * (queries[q].from + queries[q].to) - world_min) * scale, glm::vec3(0.0f), glm::vec3(1023.0f));
+		uint32_t code = spread_bits(uint32_t(cell.x)) | (spread_bits(uint32_t(cell.y)) << 1) | (spread_bits(uint32_t(cell.z)) << 2);
+		order.emplace_back(code, q);
+	}
+	std::sort(order.begin(), order.end());
+
+	uint32_t groups = (uint32_t(order.size()) + BatchGroupSize - 1) / BatchGroupSize;
+	uint32_t grain = std::max(1U, groups / (4 * Parallel::threads()));
+	Parallel::for_range(groups, grain, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t group = begin; group < end; ++group) {
+			uint32_t first = group * BatchGroupSize;
+			uint32_t last = std::min(first + BatchGroupSize, uint32_t(order.size()));
+
+			//walk the BVH once for the whole group:
+			glm::vec3 group_min = glm::vec3(std::numeric_limits< float >::infinity());
+			glm::vec3 group_max = glm::vec3(-std::numeric_limits< float >::infinity());
+			for (uint32_t i = first; i < last; ++i) {
+				glm::vec3 min, max;
+				sweep_bounds(queries[order[i].second], &min, &max);
+				group_min = glm::min(group_min, min);
+				group_max = glm::max(group_max, max);
+			}
+			scratch.leaves.clear();
+			bvh.for_each_overlapping_leaf(group_min, group_max, [](TriangleBVH::Node const &leaf) {
+				scratch.leaves.emplace_back(&leaf);
+			});
+			scratch.box_leaves.clear();
+			box_bvh.for_each_overlapping_leaf(group_min, group_max, [](TriangleBVH::Node const &leaf) {
+				scratch.box_leaves.emplace_back(&leaf);
+			});
+
+			//...then give each query the leaves near it:
+			for (uint32_t i = first; i < last; ++i) {
+				uint32_t q = order[i].second;
+				glm::vec3 min, max;
+				sweep_bounds(queries[q], &min, &max);
+				scratch.packed.clear();
+				scratch.ids.clear();
+				for (auto leaf : scratch.leaves) {
+					if (overlaps(*leaf, min, max)) push_leaf(*this, *leaf, &scratch.packed, &scratch.ids);
+				}
+				scratch.box_ids.clear();
+				for (auto leaf : scratch.box_leaves) {
+					if (overlaps(*leaf, min, max)) push_box_leaf(*this, *leaf, &scratch.box_ids);
+				}
+				test_candidates(*this, queries[q], scratch, &hits[q]);
+			}
+		}
+	});
+}
+
+void CollisionWorld::ray(std::vector< Ray > const &queries, std::vector< Hit > *hits) const {
+	std::vector< Sweep > sweeps(queries.size());
+	for (uint32_t q = 0; q < queries.size(); ++q) {
+		sweeps[q].from = queries[q].from;
+		sweeps[q].to = queries[q].to;
+	}
+	sweep(sweeps, hits);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ * A CollisionWorld answers swept-sphere and ray questions about a set of
+ *  static world-space triangles and oriented boxes (e.g., from StaticCollision).
+ *
+ * Queries can be asked one at a time or in batches (e.g., every bubble or
+ *  every bullet in a tick); batches are grouped by location so nearby queries
+ *  share one walk of the TriangleBVH, and groups run on Parallel's workers.
+ */
+
+#include "collide.hpp"
+#include "TriangleBVH.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct CollisionWorld {
+	//replace the triangles (positions[indices[3*t + i]] for each triangle t) and boxes:
+	void build(std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, std::vector< CollisionBox > const &boxes = std::vector< CollisionBox >());
+
+	//a sphere moving from 'from' to 'to':
+	struct Sweep {
+		glm::vec3 from = glm::vec3(0.0f);
+		glm::vec3 to = glm::vec3(0.0f);
+		float radius = 0.0f;
+	};
+	//a segment from 'from' to 'to' (handled as a sweep with zero radius):
+	struct Ray {
+		glm::vec3 from = glm::vec3(0.0f);
+		glm::vec3 to = glm::vec3(0.0f);
+	};
+	//earliest contact (as in collide_swept_sphere_vs_triangle), or triangle == box == -1U and t == 1 if none:
+	struct Hit {
+		uint32_t triangle = -1U; //index in 'triangles' (if a triangle was hit)
+		uint32_t box = -1U; //index in 'boxes' (if a box was hit)
+		float t = 1.0f; //fraction of the way from 'from' to 'to'
+		glm::vec3 at = glm::vec3(0.0f); //point touched
+		glm::vec3 out = glm::vec3(0.0f); //outward direction at the point touched
+	};
+
+	bool sweep(Sweep const &query, Hit *hit) const;
+	bool ray(Ray const &query, Hit *hit) const;
+
+	//(*hits)[i] is the result for queries[i]:
+	void sweep(std::vector< Sweep > const &queries, std::vector< Hit > *hits) const;
+	void ray(std::vector< Ray > const &queries, std::vector< Hit > *hits) const;
+
+	//append the triangles that might touch the box [min,max] to 'packed' (and, if given, their indices to 'ids'):
+	void gather(glm::vec3 const &min, glm::vec3 const &max, PackedTriangles *packed, std::vector< uint32_t > *ids = nullptr) const;
+	//append the indices of the boxes that might touch the box [min,max] to 'box_ids':
+	void gather_boxes(glm::vec3 const &min, glm::vec3 const &max, std::vector< uint32_t > *box_ids) const;
+
+	//world-space triangles, as passed to build():
+	std::vector< glm::vec3 > positions;
+	std::vector< uint32_t > indices;
+	//precomputed collision data (with non-convex features unmarked) for triangle t is triangles[t]:
+	std::vector< CollisionTriangle > triangles;
+	TriangleBVH bvh;
+	//boxes, as passed to build():
+	std::vector< CollisionBox > boxes;
+	//...indexed by their bounds (each box is given to the BVH as a flat triangle from its min to its max corner):
+	TriangleBVH box_bvh;
+
+	//-- internals --
+
+	//queries in a batch are grouped (by Morton order of their centers) into runs of this many:
+	static constexpr uint32_t BatchGroupSize = 16;
+};
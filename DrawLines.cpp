@@ -1,66 +1,108 @@
 #include "DrawLines.hpp"
 #include "PathFont.hpp"
 #include "ColorProgram.hpp"
+#include "FrameProfiler.hpp"
 
 #include "gl_errors.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
 //All DrawLines instances share a vertex array object and vertex buffer, initialized at load time:
 
 //n.b. declared static so they don't conflict with similarly named global variables elsewhere:
 static GLuint vertex_buffer = 0;
 static GLuint vertex_buffer_for_color_program = 0;
 
+//vertex_buffer is used as a ring:
+// each DrawLines writes its vertices just after the previous one's, with an unsynchronized map (so it doesn't wait for
+// draws that are still reading earlier parts of the buffer); when the ring is full, the buffer is orphaned and writing starts over.
+static GLsizeiptr ring_size = 1 << 20; //bytes (grows to fit the largest DrawLines)
+static GLsizeiptr ring_offset = 0;
+
+//make a vertex array object that feeds DrawLines::Vertex data from 'buffer' to color_program:
+static GLuint make_vertex_array_for_color_program(GLuint buffer) {
+	//ask OpenGL for the name of an unused vertex array object:
+	GLuint vertex_array = 0;
+	glGenVertexArrays(1, &vertex_array);
+
+	//set vertex_array as the current vertex array object:
+	glBindVertexArray(vertex_array);
+
+	//set buffer as the source of glVertexAttribPointer() commands:
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	//set up the vertex array object to describe arrays of DrawLines::Vertex:
+	glVertexAttribPointer(
+		color_program->Position_vec4, //attribute
+		3, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(DrawLines::Vertex), //stride
+		(GLbyte *)0 + offsetof(DrawLines::Vertex, Position) //offset
+	);
+	glEnableVertexAttribArray(color_program->Position_vec4);
+	//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
+
+	glVertexAttribPointer(
+		color_program->Color_vec4, //attribute
+		4, //size
+		GL_UNSIGNED_BYTE, //type
+		GL_TRUE, //normalized
+		sizeof(DrawLines::Vertex), //stride
+		(GLbyte *)0 + offsetof(DrawLines::Vertex, Color) //offset
+	);
+	glEnableVertexAttribArray(color_program->Color_vec4);
+
+	//done referring to buffer, so unbind it:
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//done setting up vertex array object, so unbind it:
+	glBindVertexArray(0);
+
+	return vertex_array;
+}
+
 static Load< void > setup_buffers(LoadTagDefault, [](){
 	//you may recognize this init code from DrawSprites.cpp:
 
 	{ //set up vertex buffer:
 		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
+		//allocate the ring (contents are written by DrawLines::~DrawLines):
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		glBufferData(GL_ARRAY_BUFFER, ring_size, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
-	{ //vertex array mapping buffer for color_program:
-		//ask OpenGL to fill vertex_buffer_for_color_program with the name of an unused vertex array object:
-		glGenVertexArrays(1, &vertex_buffer_for_color_program);
+	//vertex array mapping buffer for color_program:
+	vertex_buffer_for_color_program = make_vertex_array_for_color_program(vertex_buffer);
 
-		//set vertex_buffer_for_color_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_program);
+	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
+});
 
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+//draw 'count' vertices starting at 'first' from a vertex array made by make_vertex_array_for_color_program:
+static void draw_with_color_program(GLuint vertex_array, glm::mat4 const &world_to_clip, GLint first, GLsizei count) {
+	//set color_program as current program:
+	glUseProgram(color_program->program);
 
-		//set up the vertex array object to describe arrays of PongMode::Vertex:
-		glVertexAttribPointer(
-			color_program->Position_vec4, //attribute
-			3, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(DrawLines::Vertex), //stride
-			(GLbyte *)0 + offsetof(DrawLines::Vertex, Position) //offset
-		);
-		glEnableVertexAttribArray(color_program->Position_vec4);
-		//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
-
-		glVertexAttribPointer(
-			color_program->Color_vec4, //attribute
-			4, //size
-			GL_UNSIGNED_BYTE, //type
-			GL_TRUE, //normalized
-			sizeof(DrawLines::Vertex), //stride
-			(GLbyte *)0 + offsetof(DrawLines::Vertex, Color) //offset
-		);
-		glEnableVertexAttribArray(color_program->Color_vec4);
-
-		//done referring to vertex_buffer, so unbind it:
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//upload OBJECT_TO_CLIP to the proper uniform location:
+	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
 
-		//done setting up vertex array object, so unbind it:
-		glBindVertexArray(0);
-	}
+	//use the mapping in vertex_array to fetch vertex data:
+	glBindVertexArray(vertex_array);
 
-	GL_ERRORS(); //PARANOIA: make sure nothing strange happened during setup
-});
+	//run the OpenGL pipeline:
+	glDrawArrays(GL_LINES, first, count);
+
+	//reset vertex array to none:
+	glBindVertexArray(0);
+
+	//reset current program to none:
+	glUseProgram(0);
+}
 
 
 DrawLines::DrawLines(glm::mat4 const &world_to_clip_) : world_to_clip(world_to_clip_) {
@@ -135,30 +177,79 @@ void DrawLines::draw_text(std::string const &text, glm::vec3 const &anchor_in, g
 DrawLines::~DrawLines() {
 	if (attribs.empty()) return;
 
-	//based on DrawSprites.cpp :
+	FrameProfiler::Scope profile("DrawLines");
 
-	//upload vertices to vertex_buffer:
+	GLsizeiptr size = GLsizeiptr(attribs.size() * sizeof(attribs[0]));
+
+	//write vertices to the next part of the ring:
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, attribs.size() * sizeof(attribs[0]), attribs.data(), GL_STREAM_DRAW); //upload attribs array
+	if (ring_offset + size > ring_size) {
+		//out of room, so orphan the buffer (draws still reading the old storage keep it until they finish):
+		ring_size = std::max(ring_size, size);
+		glBufferData(GL_ARRAY_BUFFER, ring_size, nullptr, GL_STREAM_DRAW);
+		ring_offset = 0;
+	}
+	//(nothing queued reads this part of the ring, so no need for the driver to synchronize)
+	void *ptr = glMapBufferRange(GL_ARRAY_BUFFER, ring_offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!ptr) {
+		std::cerr << "WARNING: failed to map DrawLines vertex buffer; skipping lines." << std::endl;
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+	std::memcpy(ptr, attribs.data(), size);
+	if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+		//contents were lost (rare; e.g., on a display mode change) -- just skip this frame's lines:
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	//set color_program as current program:
-	glUseProgram(color_program->program);
+	draw_with_color_program(vertex_buffer_for_color_program, world_to_clip, GLint(ring_offset / sizeof(attribs[0])), GLsizei(attribs.size()));
 
-	//upload OBJECT_TO_CLIP to the proper uniform location:
-	glUniformMatrix4fv(color_program->OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	ring_offset += size;
+}
 
-	//use the mapping vertex_buffer_for_color_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_program);
+//-------- RetainedLines ---------
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_LINES, 0, GLsizei(attribs.size()));
+RetainedLines::~RetainedLines() {
+	clear();
+}
 
-	//reset vertex array to none:
-	glBindVertexArray(0);
+void RetainedLines::set(DrawLines *lines) {
+	assert(lines);
+	count = GLsizei(lines->attribs.size());
+	if (count == 0) return;
 
-	//reset current program to none:
-	glUseProgram(0);
+	if (vertex_buffer == 0) {
+		glGenBuffers(1, &vertex_buffer);
+		vertex_array = make_vertex_array_for_color_program(vertex_buffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, lines->attribs.size() * sizeof(lines->attribs[0]), lines->attribs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//the lines now live here, so 'lines' shouldn't also draw them:
+	lines->attribs.clear();
+
+	GL_ERRORS();
 }
 
+void RetainedLines::clear() {
+	if (vertex_array != 0) {
+		glDeleteVertexArrays(1, &vertex_array);
+		vertex_array = 0;
+	}
+	if (vertex_buffer != 0) {
+		glDeleteBuffers(1, &vertex_buffer);
+		vertex_buffer = 0;
+	}
+	count = 0;
+}
 
+void RetainedLines::draw(glm::mat4 const &world_to_clip) const {
+	if (count == 0) return;
+
+	FrameProfiler::Scope profile("RetainedLines");
+
+	draw_with_color_program(vertex_array, world_to_clip, 0, count);
+}
@@ -6,9 +6,15 @@
  *
  * Similar usage pattern to DrawSprites.
  *
+ * Lines that don't change from frame to frame (e.g., wireframes of static
+ * geometry) can be recorded with a DrawLines and moved to a RetainedLines,
+ * which uploads them once and draws them as often as needed.
+ *
  */
 
 
+#include "GL.hpp"
+
 #include <glm/glm.hpp>
 
 #include <string>
@@ -33,7 +39,7 @@ struct DrawLines {
 		glm::u8vec4 const &color = glm::u8vec4(0xff),
 		glm::vec3 *anchor_out = nullptr);
 
-	//Finish drawing (push attribs to GPU):
+	//Finish drawing (stream attribs to the GPU and draw them):
 	~DrawLines();
 
 
@@ -46,3 +52,24 @@ struct DrawLines {
 	std::vector< Vertex > attribs;
 
 };
+
+struct RetainedLines {
+	RetainedLines() = default;
+	~RetainedLines();
+	RetainedLines(RetainedLines const &) = delete;
+	RetainedLines &operator=(RetainedLines const &) = delete;
+
+	//replace the retained lines with the ones recorded in 'lines':
+	// (the lines are moved here, so 'lines' won't draw them when it is destroyed)
+	void set(DrawLines *lines);
+
+	//forget all lines (and free GPU storage):
+	void clear();
+
+	//draw the retained lines:
+	void draw(glm::mat4 const &world_to_clip) const;
+
+	GLsizei count = 0; //vertices retained
+	GLuint vertex_buffer = 0;
+	GLuint vertex_array = 0;
+};
@@ -2,6 +2,7 @@
 
 #include "ColorTextureProgram.hpp"
 #include "Load.hpp"
+#include "FrameProfiler.hpp"
 
 #include "GL.hpp"
 #include "gl_errors.hpp"
@@ -222,6 +223,8 @@ void DrawSprites::get_text_extents(std::string const &text, glm::vec2 const &anc
 DrawSprites::~DrawSprites() {
 	if (attribs.empty()) return;
 
+	FrameProfiler::Scope profile("DrawSprites");
+
 	//based on base0's PongMode::draw()
 
 	//upload vertices to vertex_buffer:
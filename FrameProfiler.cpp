@@ -0,0 +1,271 @@
+#include "FrameProfiler.hpp"
+
+#include "GL.hpp"
+#include "gl_errors.hpp"
+
+#include <chrono>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//frames of queries kept in flight before their results are read back:
+constexpr uint32_t FramesInFlight = 3;
+
+struct Pass {
+	Pass(std::string const &name_, uint32_t parent_, uint32_t depth_) : name(name_), parent(parent_), depth(depth_) { }
+	std::string name;
+	uint32_t parent; //-1U for top-level passes
+	uint32_t depth;
+	std::vector< uint32_t > children;
+
+	//time in the frame currently being accumulated:
+	double cpu_ms = 0.0; bool cpu_used = false;
+	double gpu_ms = 0.0; bool gpu_used = false;
+
+	//totals:
+	FrameProfiler::PassStats stats;
+	double cpu_ms_total = 0.0;
+	double gpu_ms_total = 0.0;
+};
+
+//a query covering (part of) a pass:
+struct Segment {
+	GLuint query;
+	uint32_t pass;
+};
+
+struct FrameQueries {
+	std::vector< GLuint > pool; //query objects owned by this frame
+	std::vector< Segment > segments; //queries issued this frame, in order
+	bool pending = false; //issued but not yet read back
+};
+
+bool enabled = false;
+bool in_frame = false;
+
+std::vector< Pass > passes;
+std::vector< uint32_t > roots; //top-level passes
+std::map< std::pair< uint32_t, std::string >, uint32_t > pass_lookup; //(parent, name) -> pass
+
+struct Open {
+	uint32_t pass;
+	Clock::time_point begin;
+};
+std::vector< Open > stack;
+
+FrameQueries frames[FramesInFlight];
+uint32_t frame_index = 0; //counts frames begun
+uint32_t frames_profiled = 0;
+uint32_t dropped_gpu_frames = 0;
+
+//start a GPU query for 'pass' in the current frame:
+void begin_segment(uint32_t pass) {
+	FrameQueries &frame = frames[frame_index % FramesInFlight];
+	if (frame.segments.size() == frame.pool.size()) {
+		frame.pool.emplace_back(0);
+		glGenQueries(1, &frame.pool.back());
+	}
+	GLuint query = frame.pool[frame.segments.size()];
+	frame.segments.emplace_back(Segment{query, pass});
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void end_segment() {
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+//read back a frame's GPU times (if 'wait' is false and they aren't ready, drop them):
+void resolve(FrameQueries &frame, bool wait) {
+	if (!frame.pending) return;
+	frame.pending = false;
+	if (frame.segments.empty()) return;
+
+	if (!wait) {
+		//queries complete in order, so if the last is done, all are:
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(frame.segments.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE) {
+			dropped_gpu_frames += 1;
+			frame.segments.clear();
+			return;
+		}
+	}
+
+	for (auto const &segment : frame.segments) {
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(segment.query, GL_QUERY_RESULT, &ns);
+		//a pass's GPU time includes its children's:
+		for (uint32_t p = segment.pass; p != -1U; p = passes[p].parent) {
+			passes[p].gpu_ms += double(ns) / 1.0e6;
+			passes[p].gpu_used = true;
+		}
+	}
+	frame.segments.clear();
+
+	for (auto &pass : passes) {
+		if (!pass.gpu_used) continue;
+		FrameProfiler::PassStats &stats = pass.stats;
+		stats.gpu_frames += 1;
+		stats.gpu_ms_last = pass.gpu_ms;
+		stats.gpu_ms_max = std::max(stats.gpu_ms_max, pass.gpu_ms);
+		pass.gpu_ms_total += pass.gpu_ms;
+		pass.gpu_ms = 0.0;
+		pass.gpu_used = false;
+	}
+}
+
+void collect(uint32_t pass, std::vector< FrameProfiler::PassStats > *out) {
+	Pass const &p = passes[pass];
+	out->emplace_back(p.stats);
+	FrameProfiler::PassStats &stats = out->back();
+	stats.name = p.name;
+	stats.depth = p.depth;
+	stats.cpu_ms_average = (stats.cpu_frames ? p.cpu_ms_total / stats.cpu_frames : 0.0);
+	stats.gpu_ms_average = (stats.gpu_frames ? p.gpu_ms_total / stats.gpu_frames : 0.0);
+	for (uint32_t child : p.children) {
+		collect(child, out);
+	}
+}
+
+} //unnamed namespace
+
+void FrameProfiler::init() {
+	enabled = true;
+}
+
+void FrameProfiler::shutdown() {
+	if (!enabled) return;
+	if (in_frame) end_frame();
+
+	//it's fine to wait for the last few frames now:
+	for (uint32_t i = 1; i <= FramesInFlight; ++i) {
+		resolve(frames[(frame_index + i) % FramesInFlight], true);
+	}
+
+	print_summary(std::cout);
+
+	for (auto &frame : frames) {
+		if (!frame.pool.empty()) {
+			glDeleteQueries(GLsizei(frame.pool.size()), frame.pool.data());
+		}
+		frame.pool.clear();
+	}
+	GL_ERRORS();
+
+	enabled = false;
+}
+
+void FrameProfiler::begin_frame() {
+	if (!enabled) return;
+	assert(!in_frame);
+	in_frame = true;
+
+	//read back the frame that last used this set of queries:
+	resolve(frames[frame_index % FramesInFlight], false);
+}
+
+void FrameProfiler::end_frame() {
+	if (!enabled) return;
+	assert(in_frame);
+	while (!stack.empty()) {
+		std::cerr << "WARNING: FrameProfiler pass '" << passes[stack.back().pass].name << "' was not popped before end of frame." << std::endl;
+		pop();
+	}
+	in_frame = false;
+
+	frames[frame_index % FramesInFlight].pending = true;
+	frame_index += 1;
+	frames_profiled += 1;
+
+	for (auto &pass : passes) {
+		if (!pass.cpu_used) continue;
+		PassStats &stats = pass.stats;
+		stats.cpu_frames += 1;
+		stats.cpu_ms_last = pass.cpu_ms;
+		stats.cpu_ms_max = std::max(stats.cpu_ms_max, pass.cpu_ms);
+		pass.cpu_ms_total += pass.cpu_ms;
+		pass.cpu_ms = 0.0;
+		pass.cpu_used = false;
+	}
+}
+
+void FrameProfiler::push(char const *name) {
+	if (!in_frame) return;
+
+	uint32_t parent = (stack.empty() ? -1U : stack.back().pass);
+	auto f = pass_lookup.find(std::make_pair(parent, std::string(name)));
+	if (f == pass_lookup.end()) {
+		uint32_t depth = 0;
+		std::string full_name = name;
+		if (parent != -1U) {
+			depth = passes[parent].depth + 1;
+			full_name = passes[parent].name + "/" + full_name;
+		}
+		passes.emplace_back(full_name, parent, depth);
+		if (parent != -1U) passes[parent].children.emplace_back(uint32_t(passes.size()) - 1);
+		else roots.emplace_back(uint32_t(passes.size()) - 1);
+		f = pass_lookup.insert(std::make_pair(std::make_pair(parent, std::string(name)), uint32_t(passes.size()) - 1)).first;
+	}
+	uint32_t pass = f->second;
+
+	if (!stack.empty()) end_segment();
+	begin_segment(pass);
+
+	stack.emplace_back(Open{pass, Clock::now()});
+}
+
+void FrameProfiler::pop() {
+	if (!in_frame) return;
+	assert(!stack.empty() && "FrameProfiler::pop() without matching push()");
+
+	end_segment();
+
+	Open open = stack.back();
+	stack.pop_back();
+	Pass &pass = passes[open.pass];
+	pass.cpu_ms += std::chrono::duration< double, std::milli >(Clock::now() - open.begin).count();
+	pass.cpu_used = true;
+
+	//resume parent's GPU timing:
+	if (!stack.empty()) begin_segment(stack.back().pass);
+}
+
+std::vector< FrameProfiler::PassStats > FrameProfiler::get_stats() {
+	std::vector< PassStats > ret;
+	ret.reserve(passes.size());
+	for (uint32_t root : roots) {
+		collect(root, &ret);
+	}
+	return ret;
+}
+
+uint32_t FrameProfiler::get_frames() {
+	return frames_profiled;
+}
+
+uint32_t FrameProfiler::get_dropped_gpu_frames() {
+	return dropped_gpu_frames;
+}
+
+void FrameProfiler::print_summary(std::ostream &out) {
+	out << "---- frame profile (" << frames_profiled << " frames, " << dropped_gpu_frames << " without GPU times) ----\n";
+	out << std::left << std::setw(32) << "pass"
+		<< std::right << std::setw(12) << "cpu avg ms" << std::setw(12) << "cpu max ms"
+		<< std::setw(12) << "gpu avg ms" << std::setw(12) << "gpu max ms" << "\n";
+	out << std::fixed << std::setprecision(3);
+	for (auto const &stats : get_stats()) {
+		//indent by depth, showing only the last part of the name:
+		std::string label = std::string(2 * stats.depth, ' ') + stats.name.substr(stats.name.rfind('/') + 1);
+		out << std::left << std::setw(32) << label << std::right
+			<< std::setw(12) << stats.cpu_ms_average << std::setw(12) << stats.cpu_ms_max
+			<< std::setw(12) << stats.gpu_ms_average << std::setw(12) << stats.gpu_ms_max << "\n";
+	}
+	out << std::defaultfloat;
+	out.flush();
+}
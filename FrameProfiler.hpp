@@ -0,0 +1,55 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//Per-pass CPU and GPU frame timing.
+//GPU time comes from GL_TIME_ELAPSED queries, which are read back a few
+// frames later (and only if already available), so profiling never stalls the pipeline.
+//When profiling isn't enabled, all calls are cheap no-ops.
+
+namespace FrameProfiler {
+
+//call after the GL context is created to start profiling:
+void init();
+//print a summary (if profiling was enabled) and release query objects; call before destroying the GL context:
+void shutdown();
+
+//bracket each frame:
+void begin_frame();
+void end_frame();
+
+//bracket a pass within a frame; passes may nest:
+// note: GL_TIME_ELAPSED queries can't nest, so a parent's query is ended while a child runs,
+//       and the parent's GPU time includes that of its children.
+void push(char const *name);
+void pop();
+
+//convenience wrapper for push/pop:
+struct Scope {
+	Scope(char const *name) { push(name); }
+	~Scope() { pop(); }
+	Scope(Scope const &) = delete;
+};
+
+//accumulated statistics:
+struct PassStats {
+	std::string name; //nested passes are named "parent/child"
+	uint32_t depth = 0; //nesting depth (0 == top level)
+	uint32_t cpu_frames = 0; //frames with a CPU time for this pass
+	uint32_t gpu_frames = 0; //frames with a GPU time for this pass (read-back frames that weren't ready are skipped)
+	double cpu_ms_last = 0.0, cpu_ms_average = 0.0, cpu_ms_max = 0.0;
+	double gpu_ms_last = 0.0, gpu_ms_average = 0.0, gpu_ms_max = 0.0;
+};
+//passes are returned parent-before-children, siblings in order of first use:
+std::vector< PassStats > get_stats();
+
+//frames profiled, and frames whose GPU results weren't ready when their queries had to be reused:
+uint32_t get_frames();
+uint32_t get_dropped_gpu_frames();
+
+void print_summary(std::ostream &out);
+
+} //namespace FrameProfiler
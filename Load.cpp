@@ -17,13 +17,13 @@ void add_load_function(LoadTag tag, std::function< void() > const &fn) {
 	load_lists[tag].emplace_back(fn);
 }
 
-void call_load_functions() {
-	static bool has_been_called = false;
-	assert(!has_been_called && "call_load_functions should only be called *once*");
-	has_been_called = true;
+void call_load_functions(LoadTag last) {
+	static uint32_t next_tag = 0;
+	assert(next_tag <= uint32_t(last) && "call_load_functions should be called with increasing tags");
 
 	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
+	for (; next_tag <= uint32_t(last) && next_tag < load_lists.size(); ++next_tag) {
+		auto &fn_list = load_lists[next_tag];
 		while (!fn_list.empty()) {
 			(*fn_list.begin())(); //call first function in the list
 			fn_list.pop_front(); //remove from list
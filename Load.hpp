@@ -19,6 +19,7 @@
  *
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
+ * (MeshBuffers and SpriteAtlases are read in the background, so looking things up in them with LoadTagLate lets them load in parallel.)
  *
  */
 
@@ -36,10 +37,10 @@ enum LoadTag : uint32_t {
 // (only call *before* "call_load_functions()")
 void add_load_function(LoadTag tag, std::function< void() > const &fn);
 
-//Call all loading functions:
+//Call loading functions with tags up to and including 'last' that haven't been called yet:
 // (loading functions may throw exceptions if they fail.)
-// (only call *once*)
-void call_load_functions();
+// (call with increasing tags -- e.g., to pump the UploadQueue between LoadTagDefault and LoadTagLate -- or just once)
+void call_load_functions(LoadTag last = LoadTagLate);
 
 
 //work-around for MSVC not accepting this as a lambda:
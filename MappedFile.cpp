@@ -0,0 +1,81 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string const &filename_) : filename(filename_) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	file_handle = file;
+	if (size == 0) return; //(can't map empty files)
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to create mapping of '" + filename + "'.");
+	}
+	mapping_handle = mapping;
+	data = reinterpret_cast< char const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map view of '" + filename + "'.");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(reinterpret_cast< HANDLE >(mapping_handle));
+	if (file_handle) CloseHandle(reinterpret_cast< HANDLE >(file_handle));
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename_) : filename(filename_) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size != 0) { //(can't map empty files)
+		void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("Failed to map '" + filename + "'.");
+		}
+		data = reinterpret_cast< char const * >(mapped);
+	}
+	//the mapping stays valid after the descriptor is closed:
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< char * >(data), size);
+}
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+//A read-only view of a whole file, mapped into memory.
+//Pages are read in by the OS as they are touched, so nothing is zero-filled or
+// copied until it is used (see the MappedFile read_chunk in read_write_chunk.hpp).
+
+struct MappedFile {
+	//note: will throw if the file can't be opened or mapped:
+	MappedFile(std::string const &filename);
+	~MappedFile();
+
+	//the mapping is owned, so copying doesn't make sense:
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	std::string filename; //(for error messages)
+	char const *data = nullptr; //start of mapping (page-aligned; nullptr for empty files)
+	size_t size = 0; //size of file in bytes
+
+	//-- internals --
+	#if defined(_WIN32)
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+	#endif
+};
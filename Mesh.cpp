@@ -1,97 +1,249 @@
 #include "Mesh.hpp"
-#include "read_write_chunk.hpp"
+#include "load_save_pnct.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <tuple>
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+#include <limits>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
-
-	std::ifstream file(filename, std::ios::binary);
-
-	GLuint total = 0;
-
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
-	};
-	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
+//compact vertex layout for CompactVertices:
+struct CompactVertex {
+	glm::u16vec3 Position; //normalized to buffer bounds
+	uint16_t padding; //(keeps the packed normal 4-byte aligned)
+	uint32_t Normal; //GL_INT_2_10_10_10_REV
+	glm::u8vec4 Color;
+	glm::u16vec2 TexCoord; //half floats
+};
+static_assert(sizeof(CompactVertex) == 3*2+2+4+4*1+2*2, "CompactVertex is packed.");
 
-	//read + upload data chunk:
-	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+MeshBuffer::MeshBuffer(std::string const &filename, VertexFormat format, std::set< std::string > const &collision_meshes) {
+	typedef PnctFile::Vertex Vertex;
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		total = GLuint(data.size()); //store total for later checks on index
+	if (!(filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct")) {
+		throw std::runtime_error("Unknown file type '" + filename + "'");
+	}
 
-		//store attrib locations:
+	//store attrib locations (these only depend on the format, so are available before the file is read):
+	if (format == FullVertices) {
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
 		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
 		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
 		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+	} else if (format == CompactVertices) {
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex), offsetof(CompactVertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), offsetof(CompactVertex, TexCoord));
 	} else {
-		throw std::runtime_error("Unknown file type '" + filename + "'");
+		throw std::runtime_error("Unknown vertex format " + std::to_string(format) + ".");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	glGenBuffers(1, &buffer);
+	glGenBuffers(1, &index_buffer);
+
+	//read and decode the file on a worker thread, then stream the data to 'buffer' and 'index_buffer':
+	// (lookup() waits for the file to be read)
+	loading = UploadQueue::submit([this,filename,format,collision_meshes](UploadQueue::Uploads *uploads) {
+		load(filename, format, collision_meshes, uploads);
+	});
+}
+
+MeshBuffer::~MeshBuffer() {
+	//the loading job refers to this buffer, so let it finish first:
+	try {
+		UploadQueue::wait_uploaded(loading);
+	} catch (std::exception &) {
+		//(the error was the loader's to report)
+	}
+	for (auto const &lv : vaos) {
+		glDeleteVertexArrays(1, &lv.second);
+	}
+	vaos.clear();
+	glDeleteBuffers(1, &index_buffer);
+	index_buffer = 0;
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void MeshBuffer::load(std::string const &filename, VertexFormat format, std::set< std::string > const &collision_meshes, UploadQueue::Uploads *uploads) {
+	typedef PnctFile::Vertex Vertex;
+	PnctFile pnct;
 
-	{ //read index chunk, add to meshes:
-		struct IndexEntry {
-			uint32_t name_begin, name_end;
-			uint32_t vertex_begin, vertex_end;
+	load_pnct(filename, &pnct);
+	//files written without indices are triangle soups, so merge shared vertices:
+	index_pnct(&pnct);
+
+	uploads->buffers.emplace_back();
+	UploadQueue::BufferUpload &vertex_upload = uploads->buffers.back();
+	vertex_upload.buffer = buffer;
+
+	if (format == FullVertices) {
+		vertex_upload.data.resize(pnct.vertices.size() * sizeof(Vertex));
+		if (!pnct.vertices.empty()) std::memcpy(vertex_upload.data.data(), pnct.vertices.data(), vertex_upload.data.size());
+	} else { assert(format == CompactVertices);
+		//positions are stored relative to the bounds of all vertices:
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (auto const &v : pnct.vertices) {
+			min = glm::min(min, v.Position);
+			max = glm::max(max, v.Position);
+		}
+		if (pnct.vertices.empty()) min = max = glm::vec3(0.0f);
+		glm::vec3 extent = max - min;
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (!(extent[c] > 0.0f)) extent[c] = 1.0f;
+		}
+		position_to_object = glm::mat4(
+			glm::vec4(extent.x, 0.0f, 0.0f, 0.0f),
+			glm::vec4(0.0f, extent.y, 0.0f, 0.0f),
+			glm::vec4(0.0f, 0.0f, extent.z, 0.0f),
+			glm::vec4(min, 1.0f)
+		);
+
+		auto snorm10 = [](float x) -> uint32_t {
+			int32_t i = int32_t(std::round(std::max(-1.0f, std::min(1.0f, x)) * 511.0f));
+			return uint32_t(i) & 0x3ffU;
 		};
-		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
-		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		vertex_upload.data.resize(pnct.vertices.size() * sizeof(CompactVertex));
+		CompactVertex *compact = reinterpret_cast< CompactVertex * >(vertex_upload.data.data());
+		for (auto const &v : pnct.vertices) {
+			CompactVertex &cv = *(compact++);
+			glm::vec3 p = glm::round((v.Position - min) / extent * 65535.0f);
+			cv.Position = glm::u16vec3(glm::clamp(p, glm::vec3(0.0f), glm::vec3(65535.0f)));
+			cv.padding = 0;
+			cv.Normal = snorm10(v.Normal.x) | (snorm10(v.Normal.y) << 10) | (snorm10(v.Normal.z) << 20);
+			cv.Color = v.Color;
+			cv.TexCoord = glm::u16vec2(glm::packHalf1x16(v.TexCoord.x), glm::packHalf1x16(v.TexCoord.y));
+		}
+	}
 
-		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-				throw std::runtime_error("index entry has out-of-range name begin/end");
-			}
-			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
-				throw std::runtime_error("index entry has out-of-range vertex start/count");
+	//indices (as 16-bit values if they fit):
+	index_type = GL_UNSIGNED_INT;
+	index_count = GLuint(pnct.indices.size());
+	uploads->buffers.emplace_back();
+	UploadQueue::BufferUpload &index_upload = uploads->buffers.back();
+	index_upload.buffer = index_buffer;
+	if (pnct.vertices.size() <= 0x10000) {
+		index_type = GL_UNSIGNED_SHORT;
+		index_upload.data.resize(pnct.indices.size() * sizeof(uint16_t));
+		uint16_t *indices16 = reinterpret_cast< uint16_t * >(index_upload.data.data());
+		for (uint32_t i : pnct.indices) {
+			*(indices16++) = uint16_t(i);
+		}
+	} else {
+		index_upload.data.resize(pnct.indices.size() * sizeof(uint32_t));
+		if (!pnct.indices.empty()) std::memcpy(index_upload.data.data(), pnct.indices.data(), index_upload.data.size());
+	}
+
+	//collision positions are deduplicated by value (vertices differing only in normal, color, etc. share one):
+	std::map< std::tuple< float, float, float >, uint32_t > position_to_collision;
+	std::vector< uint32_t > vertex_to_collision(pnct.vertices.size(), -1U);
+	auto collision_index = [&](uint32_t vertex) -> uint32_t {
+		uint32_t &ret = vertex_to_collision[vertex];
+		if (ret == -1U) {
+			glm::vec3 const &p = pnct.vertices[vertex].Position;
+			auto f = position_to_collision.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z), uint32_t(collision_positions.size())));
+			if (f.second) collision_positions.emplace_back(p);
+			ret = f.first->second;
+		}
+		return ret;
+	};
+
+	//add index entries to meshes:
+	// (ranges were checked against the index count by load_pnct)
+	for (auto const &entry : pnct.meshes) {
+		Mesh mesh;
+		mesh.type = GL_TRIANGLES;
+		mesh.start = entry.vertex_begin;
+		mesh.count = entry.vertex_end - entry.vertex_begin;
+		mesh.index_type = index_type;
+		mesh.position_to_object = position_to_object;
+		for (uint32_t i = entry.vertex_begin; i < entry.vertex_end; ++i) {
+			mesh.min = glm::min(mesh.min, pnct.vertices[pnct.indices[i]].Position);
+			mesh.max = glm::max(mesh.max, pnct.vertices[pnct.indices[i]].Position);
+		}
+		glm::vec3 center = 0.5f * (mesh.min + mesh.max);
+		for (uint32_t i = entry.vertex_begin; i < entry.vertex_end; ++i) {
+			mesh.radius = std::max(mesh.radius, glm::length(pnct.vertices[pnct.indices[i]].Position - center));
+		}
+		if (is_collider_name(entry.name) || collision_meshes.count(entry.name)) {
+			mesh.collision_start = GLuint(collision_indices.size());
+			for (uint32_t i = entry.vertex_begin; i + 2 < entry.vertex_end; i += 3) {
+				uint32_t a = collision_index(pnct.indices[i+0]);
+				uint32_t b = collision_index(pnct.indices[i+1]);
+				uint32_t c = collision_index(pnct.indices[i+2]);
+				//triangles that became degenerate when positions were merged can't be hit:
+				if (a == b || b == c || c == a) continue;
+				collision_indices.emplace_back(a);
+				collision_indices.emplace_back(b);
+				collision_indices.emplace_back(c);
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
-			Mesh mesh;
-			mesh.type = GL_TRIANGLES;
-			mesh.start = entry.vertex_begin;
-			mesh.count = entry.vertex_end - entry.vertex_begin;
-			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
-				mesh.min = glm::min(mesh.min, data[v].Position);
-				mesh.max = glm::max(mesh.max, data[v].Position);
+			mesh.collision_count = GLuint(collision_indices.size()) - mesh.collision_start;
+		}
+		bool inserted = meshes.insert(std::make_pair(entry.name, std::move(mesh))).second;
+		if (!inserted) {
+			std::cerr << "WARNING: mesh name '" + entry.name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+		}
+	}
+
+	//attach "<name>.LOD<n>" meshes as levels of detail of "<name>":
+	{
+		std::map< std::string, std::map< uint32_t, Mesh const * > > lods;
+		for (auto const &nm : meshes) {
+			std::string base;
+			uint32_t level = 0;
+			if (!is_lod_name(nm.first, &base, &level)) continue;
+			lods[base][level] = &nm.second;
+		}
+		for (auto const &bl : lods) {
+			auto f = meshes.find(bl.first);
+			if (f == meshes.end()) {
+				std::cerr << "WARNING: level of detail for mesh '" << bl.first << "' in filename '" << filename << "', but no such mesh." << std::endl;
+				continue;
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			for (auto const &ll : bl.second) {
+				if (ll.second->type != f->second.type) {
+					throw std::runtime_error("Level of detail " + std::to_string(ll.first) + " of mesh '" + bl.first + "' has a different primitive type.");
+				}
+				Mesh::LOD lod;
+				lod.start = ll.second->start;
+				lod.count = ll.second->count;
+				f->second.lods.emplace_back(lod);
 			}
 		}
 	}
 
-	if (file.peek() != EOF) {
-		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
+	//attach "<name>.Collider" meshes as collision stand-ins for "<name>":
+	for (auto const &nm : meshes) {
+		std::string base;
+		if (!is_collider_name(nm.first, &base)) continue;
+		auto f = meshes.find(base);
+		if (f == meshes.end()) {
+			std::cerr << "WARNING: collider for mesh '" << base << "' in filename '" << filename << "', but no such mesh." << std::endl;
+			continue;
+		}
+		f->second.collider = &nm.second;
 	}
 
-	//store positions for collision detection use:
-	positions.reserve(data.size());
-	for (auto const &v : data) {
-		positions.emplace_back(v.Position);
+	for (auto const &name : collision_meshes) {
+		if (!meshes.count(name)) {
+			throw std::runtime_error("Collision mesh '" + name + "' isn't in filename '" + filename + "'.");
+		}
 	}
+	collision_positions.shrink_to_fit();
 
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
@@ -104,7 +256,12 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 	*/
 }
 
+void MeshBuffer::wait() const {
+	UploadQueue::wait_loaded(loading);
+}
+
 const Mesh &MeshBuffer::lookup(std::string const &name) const {
+	wait();
 	auto f = meshes.find(name);
 	if (f == meshes.end()) {
 		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
@@ -112,45 +269,86 @@ const Mesh &MeshBuffer::lookup(std::string const &name) const {
 	return f->second;
 }
 
+namespace {
+	//attributes a MeshBuffer can supply, in the order used by ProgramAttribs::locations:
+	char const *AttribNames[4] = { "Position", "Normal", "Color", "TexCoord" };
+
+	//a program's attribute layout, introspected once per program:
+	struct ProgramAttribs {
+		MeshBuffer::AttribLocations locations; //location of each of AttribNames (-1 if not used by the program)
+		std::vector< std::string > unknown; //active attributes that aren't any of AttribNames
+	};
+
+	ProgramAttribs const &get_program_attribs(GLuint program) {
+		//(programs are never deleted, so their names are never reused)
+		static std::unordered_map< GLuint, ProgramAttribs > cache;
+		auto f = cache.find(program);
+		if (f != cache.end()) return f->second;
+
+		ProgramAttribs attribs;
+		for (uint32_t i = 0; i < 4; ++i) {
+			attribs.locations[i] = glGetAttribLocation(program, AttribNames[i]);
+		}
+
+		GLint active = 0;
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
+		assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
+		for (GLuint i = 0; i < GLuint(active); ++i) {
+			GLchar name[100];
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
+			name[99] = '\0';
+			GLint location = glGetAttribLocation(program, name);
+			if (std::find(attribs.locations.begin(), attribs.locations.end(), location) == attribs.locations.end()) {
+				attribs.unknown.emplace_back(name);
+			}
+		}
+
+		return cache.insert(std::make_pair(program, attribs)).first->second;
+	}
+}
+
 GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+	ProgramAttribs const &program_attribs = get_program_attribs(program);
+	Attrib const *attribs[4] = { &Position, &Normal, &Color, &TexCoord };
+
+	//Check that all active attributes can be bound:
+	if (!program_attribs.unknown.empty()) {
+		throw std::runtime_error("ERROR: active attribute '" + program_attribs.unknown[0] + "' in program is not bound.");
+	}
+	for (uint32_t i = 0; i < 4; ++i) {
+		if (program_attribs.locations[i] != -1 && attribs[i]->size == 0) {
+			throw std::runtime_error("ERROR: active attribute '" + std::string(AttribNames[i]) + "' in program is not bound.");
+		}
+	}
+
+	//programs with the same attribute locations can share a vertex array object:
+	auto f = vaos.find(program_attribs.locations);
+	if (f != vaos.end()) return f->second;
+
 	//create a new vertex array object:
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	//Try to bind all attributes in this buffer:
-	std::set< GLuint > bound;
+	//Bind all attributes in this buffer that the program uses:
 	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	auto bind_attribute = [&](char const *name, MeshBuffer::Attrib const &attrib) {
-		if (attrib.size == 0) return; //don't bind empty attribs
-		GLint location = glGetAttribLocation(program, name);
-		if (location == -1) return; //can't bind missing attribs
+	for (uint32_t i = 0; i < 4; ++i) {
+		GLint location = program_attribs.locations[i];
+		Attrib const &attrib = *attribs[i];
+		if (attrib.size == 0) continue; //don't bind empty attribs
+		if (location == -1) continue; //can't bind missing attribs
 		glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
 		glEnableVertexAttribArray(location);
-		bound.insert(location);
-	};
-	bind_attribute("Position", Position);
-	bind_attribute("Normal", Normal);
-	bind_attribute("Color", Color);
-	bind_attribute("TexCoord", TexCoord);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//element buffer binding is part of vertex array state:
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
 	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	//Check that all active attributes were bound:
-	GLint active = 0;
-	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
-	assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
-	for (GLuint i = 0; i < GLuint(active); ++i) {
-		GLchar name[100];
-		GLint size = 0;
-		GLenum type = 0;
-		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
-		name[99] = '\0';
-		GLint location = glGetAttribLocation(program, name);
-		if (!bound.count(GLuint(location))) {
-			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
-		}
-	}
+	vaos.insert(std::make_pair(program_attribs.locations, vao));
 
 	return vao;
 }
@@ -10,8 +10,11 @@
  */
 
 #include "GL.hpp"
+#include "UploadQueue.hpp"
 #include <glm/glm.hpp>
+#include <array>
 #include <map>
+#include <set>
 #include <limits>
 #include <string>
 #include <vector>
@@ -21,36 +24,94 @@ struct Mesh {
 	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
 
 	GLenum type = GL_TRIANGLES; //type of primitives in mesh
-	GLuint start = 0; //index of first vertex
-	GLuint count = 0; //count of vertices
+	GLuint start = 0; //index of first vertex (or first index, for indexed meshes)
+	GLuint count = 0; //count of vertices (or indices)
+	GLenum index_type = GL_NONE; //type of indices in the buffer's index_buffer, or GL_NONE if not indexed
+
+	//Takes Position attribute values to object space (not identity when positions are quantized):
+	glm::mat4 position_to_object = glm::mat4(1.0f);
 
 	//Bounding box.
 	//useful for debug visualization and collision detection:
 	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
 	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	//Bounding sphere (around the center of the bounding box).
+	//useful for level-of-detail selection:
+	float radius = 0.0f;
+
+	//Lower levels of detail, coarsest last.
+	// these come from meshes named "<name>.LOD1", "<name>.LOD2", ... in the same file:
+	struct LOD {
+		GLuint start = 0;
+		GLuint count = 0;
+	};
+	std::vector< LOD > lods;
+
+	//Simplified stand-in to use for collision detection, if any.
+	// this comes from a mesh named "<name>.Collider" in the same file (see simplify-colliders.cpp):
+	Mesh const *collider = nullptr;
+
+	//Triangles kept on the CPU for collision detection (only for meshes requested when loading the MeshBuffer, and ".Collider" meshes):
+	// triangle vertices are collision_positions[collision_indices[collision_start + i]] for i in [0, collision_count):
+	GLuint collision_start = 0;
+	GLuint collision_count = 0;
 };
 
 struct MeshBuffer {
+	//layout of vertex data in 'buffer':
+	enum VertexFormat : uint32_t {
+		//exactly as in the file (36 bytes):
+		FullVertices,
+		//20 bytes: 16-bit Position (normalized to the buffer's bounds; see position_to_object),
+		// 10-10-10-2 Normal, 8-bit Color, half-float TexCoord:
+		CompactVertices,
+	};
+
 	//construct from a file:
-	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// 'collision_meshes' names the meshes whose triangles should also be kept on the CPU for collision detection.
+	// (triangles of "<name>.Collider" meshes are always kept, and those meshes are attached to "<name>" as its collider)
+	// the file is read and uploaded through the UploadQueue (the destructor waits for that to finish).
+	// note: will throw (here or from wait()) if file fails to read or if a collision mesh isn't in the file.
+	MeshBuffer(std::string const &filename, VertexFormat format = FullVertices, std::set< std::string > const &collision_meshes = std::set< std::string >());
+	~MeshBuffer();
+	//(the loading job refers to the buffer, so it can't be copied)
+	MeshBuffer(MeshBuffer const &) = delete;
+	MeshBuffer &operator=(MeshBuffer const &) = delete;
+
+	//wait for the file to be read; until then, only 'buffer', 'index_buffer', and the Attribs are valid:
+	// (the data might not be uploaded yet; see UploadQueue)
+	void wait() const;
 
 	//look up a particular mesh by name:
-	// note: will throw if mesh not found.
+	// note: waits for the file to be read; will throw if mesh not found.
 	const Mesh &lookup(std::string const &name) const;
 	
-	//build a vertex array object that links this vbo to attributes to a program:
+	//get a vertex array object that links this vbo to attributes to a program:
+	// programs whose attributes have the same locations share a vertex array object,
+	// which is owned by the buffer (so don't delete it).
 	// note: will throw if program defines attributes not contained in this buffer
 	GLuint make_vao_for_program(GLuint program) const;
 
 	//This is the OpenGL vertex buffer object containing the mesh data:
 	GLuint buffer = 0;
+	//...and the element buffer object with indices into it:
+	// (bound to the vertex array objects made by make_vao_for_program)
+	GLuint index_buffer = 0;
+	GLenum index_type = GL_NONE; //type of the values in index_buffer
+	GLuint index_count = 0; //number of values in index_buffer
+	//takes Position attribute values to object space (also stored in each Mesh):
+	glm::mat4 position_to_object = glm::mat4(1.0f);
 
 	//-- internals ---
 
 	//used by the lookup() function:
 	std::map< std::string, Mesh > meshes;
 
+	//vertex array objects made by make_vao_for_program, by program attribute locations (Position, Normal, Color, TexCoord; -1 if unused):
+	typedef std::array< GLint, 4 > AttribLocations;
+	mutable std::map< AttribLocations, GLuint > vaos;
+
 	//These 'Attrib' structures describe the location of various attributes within the buffer (in exactly format wanted by glVertexAttribPointer). They are set when the file is loaded and are used by the "make_vao_for_program" call:
 	struct Attrib {
 		GLint size = 0;
@@ -69,6 +130,14 @@ struct MeshBuffer {
 	Attrib Color;
 	Attrib TexCoord;
 
-	//local copy of vertex information: (for collision detection)
-	std::vector< glm::vec3 > positions;
+	//reading / uploading of the file's data:
+	UploadQueue::Ticket loading;
+	//(runs on a worker thread)
+	void load(std::string const &filename, VertexFormat format, std::set< std::string > const &collision_meshes, UploadQueue::Uploads *uploads);
+
+	//local copy of the collision meshes' triangles:
+	// positions are shared between all collision meshes and deduplicated;
+	// triangle vertices are collision_positions[collision_indices[mesh.collision_start + i]] for i in [0, mesh.collision_count):
+	std::vector< glm::vec3 > collision_positions;
+	std::vector< uint32_t > collision_indices;
 };
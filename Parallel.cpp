@@ -0,0 +1,143 @@
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+namespace {
+
+bool running = false;
+
+//only one for_range() hands out work at a time:
+std::mutex call_mutex;
+
+//shared with worker threads:
+std::mutex mutex;
+std::condition_variable work_cv; //signalled when a new range starts or 'stopping' is set
+std::condition_variable done_cv; //signalled when 'busy' drops to zero
+bool stopping = false;
+uint32_t generation = 0; //incremented for every range handed out
+uint32_t busy = 0; //workers that have joined the current range and not yet finished
+std::function< void(uint32_t, uint32_t) > const *task = nullptr;
+uint32_t task_count = 0;
+uint32_t task_grain = 1;
+std::atomic< uint32_t > next_begin(0);
+std::exception_ptr error;
+std::vector< std::thread > workers;
+
+//set on worker threads (and while a range is running on the calling thread), so nested calls run serially:
+thread_local bool inside = false;
+
+//claim and run chunks until the range is used up:
+void run_chunks() {
+	while (true) {
+		uint32_t begin = next_begin.fetch_add(task_grain);
+		if (begin >= task_count) break;
+		uint32_t end = begin + std::min(task_grain, task_count - begin);
+		try {
+			(*task)(begin, end);
+		} catch (...) {
+			std::unique_lock< std::mutex > lock(mutex);
+			if (!error) error = std::current_exception();
+		}
+	}
+}
+
+void worker() {
+	inside = true;
+	uint32_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			work_cv.wait(lock, [&seen](){ return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+			busy += 1;
+		}
+		run_chunks();
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			busy -= 1;
+			if (busy == 0) done_cv.notify_all();
+		}
+	}
+}
+
+} //unnamed namespace
+
+void Parallel::init(uint32_t count) {
+	assert(!running);
+	if (count == 0) {
+		count = std::max(2U, std::thread::hardware_concurrency()) - 1;
+	}
+	stopping = false;
+	for (uint32_t i = 0; i < count; ++i) {
+		workers.emplace_back(worker);
+	}
+	running = true;
+}
+
+void Parallel::shutdown() {
+	if (!running) return;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		stopping = true;
+	}
+	work_cv.notify_all();
+	for (auto &thread : workers) {
+		thread.join();
+	}
+	workers.clear();
+	running = false;
+}
+
+uint32_t Parallel::threads() {
+	return uint32_t(workers.size()) + 1;
+}
+
+void Parallel::for_range(uint32_t count, uint32_t grain, std::function< void(uint32_t begin, uint32_t end) > const &fn) {
+	grain = std::max(1U, grain);
+	if (count == 0) return;
+
+	//small, nested, or pool-less ranges just run here:
+	if (!running || inside || count <= grain) {
+		for (uint32_t begin = 0; begin < count; begin += grain) {
+			fn(begin, begin + std::min(grain, count - begin));
+		}
+		return;
+	}
+
+	std::unique_lock< std::mutex > call_lock(call_mutex);
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		//(workers that woke up late for the previous range may still be leaving it)
+		done_cv.wait(lock, [](){ return busy == 0; });
+		task = &fn;
+		task_count = count;
+		task_grain = grain;
+		next_begin = 0;
+		error = nullptr;
+		generation += 1;
+	}
+	work_cv.notify_all();
+
+	inside = true;
+	run_chunks();
+	inside = false;
+
+	std::exception_ptr thrown;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		//every chunk has been claimed, so once no worker is busy they are all done:
+		done_cv.wait(lock, [](){ return busy == 0; });
+		task = nullptr;
+		thrown = error;
+		error = nullptr;
+	}
+	if (thrown) std::rethrow_exception(thrown);
+}
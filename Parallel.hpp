@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+//Splits loops across a pool of worker threads:
+// - for_range() hands out chunks of an index range to the workers and the calling thread,
+//   and returns once every chunk is done.
+//When the pool isn't running (init() not called -- e.g., in tools), or when called from
+// inside another for_range(), loops just run on the calling thread.
+
+namespace Parallel {
+
+//start worker threads (0 == one fewer than the number of hardware threads, but at least one):
+void init(uint32_t workers = 0);
+//stop worker threads:
+void shutdown();
+
+//number of threads for_range() spreads work over (workers plus the calling thread):
+uint32_t threads();
+
+//call fn(begin, end) for chunks [begin, end) of [0, count), each at most 'grain' long:
+// chunks may run in any order and at the same time, so fn must only write to per-chunk data.
+// if any call throws, one of the exceptions is rethrown once all chunks are done.
+void for_range(uint32_t count, uint32_t grain, std::function< void(uint32_t begin, uint32_t end) > const &fn);
+
+} //namespace Parallel
@@ -10,34 +10,26 @@
 Mesh const *mesh_Goal = nullptr;
 Mesh const *mesh_Sphere = nullptr;
 
-//names of mesh-to-collider-mesh:
-std::unordered_map< Mesh const *, Mesh const * > mesh_to_collider;
-
 GLuint roll_meshes_for_lit_color_texture_program = 0;
 
 //Load the meshes used in Sphere Roll levels:
 Load< MeshBuffer > roll_meshes(LoadTagDefault, []() -> MeshBuffer * {
-	MeshBuffer *ret = new MeshBuffer(data_path("roll-parts.pnct"));
+	//(the ".Collider" meshes made by simplify-colliders keep their triangles for collision detection)
+	MeshBuffer *ret = new MeshBuffer(data_path("roll-parts.pnct"), MeshBuffer::CompactVertices);
 
 	//Build vertex array object for the program we're using to shade these meshes:
 	roll_meshes_for_lit_color_texture_program = ret->make_vao_for_program(lit_color_texture_program->program);
 
-	//key objects:
-	mesh_Goal = &ret->lookup("Goal");
-	mesh_Sphere = &ret->lookup("Sphere");
-	
-	//these meshes collide as (simpler) boxes:
-	mesh_to_collider.insert(std::make_pair(&ret->lookup("Block.Dark"), &ret->lookup("Block.Simple")));
-	mesh_to_collider.insert(std::make_pair(&ret->lookup("Block.Light"), &ret->lookup("Block.Simple")));
-
-	//these meshes collide as themselves:
-	mesh_to_collider.insert(std::make_pair(&ret->lookup("Round.Quarter"), &ret->lookup("Round.Quarter")));
-	mesh_to_collider.insert(std::make_pair(&ret->lookup("Round.Corner"), &ret->lookup("Round.Corner")));
-	mesh_to_collider.insert(std::make_pair(&ret->lookup("Round.Corner.Outer"), &ret->lookup("Round.Corner.Outer")));
-
 	return ret;
 });
 
+//key objects:
+// (looked up once the file has been read, so it can be read alongside the other resources)
+Load< void > roll_meshes_lookup(LoadTagLate, []() {
+	mesh_Goal = &roll_meshes->lookup("Goal");
+	mesh_Sphere = &roll_meshes->lookup("Sphere");
+});
+
 //Load sphere roll levels:
 Load< std::list< RollLevel > > roll_levels(LoadTagLate, []() -> std::list< RollLevel > * {
 	std::list< RollLevel > *ret = new std::list< RollLevel >();
@@ -66,6 +58,8 @@ RollLevel::RollLevel(std::string const &scene_file) {
 		pipeline.type = mesh->type;
 		pipeline.start = mesh->start;
 		pipeline.count = mesh->count;
+		pipeline.index_type = mesh->index_type;
+		pipeline.position_to_object = mesh->position_to_object;
 
 
 		//associate level info with the drawable:
@@ -77,9 +71,10 @@ RollLevel::RollLevel(std::string const &scene_file) {
 		} else if (mesh == mesh_Goal) {
 			goals.emplace_back(transform);
 		} else {
-			auto f = mesh_to_collider.find(mesh);
-			if (f != mesh_to_collider.end()) {
-				mesh_colliders.emplace_back(transform, *f->second, *roll_meshes);
+			//meshes with a simplified stand-in are solid:
+			// (box-shaped stand-ins, like the blocks', are tested by StaticCollision as single oriented boxes)
+			if (mesh->collider) {
+				mesh_colliders.emplace_back(transform, *mesh->collider, *roll_meshes);
 			} else {
 				//just decoration.
 				++decorations;
@@ -91,6 +86,8 @@ RollLevel::RollLevel(std::string const &scene_file) {
 		throw std::runtime_error("Level '" + scene_file + "' contains no Sphere (starting location).");
 	}
 
+	build_static_collision();
+
 	std::cout << "Level '" << scene_file << "' has "
 		<< mesh_colliders.size() << " mesh colliders, "
 		<< goals.size() << " goals "
@@ -169,6 +166,18 @@ RollLevel &RollLevel::operator=(RollLevel const &other) {
 	player = other.player;
 	player.transform = transform_to_transform.at(player.transform);
 
+	//(re-bake, since the baked data refers to other's transforms)
+	build_static_collision();
+
 	return *this;
 }
 
+void RollLevel::build_static_collision() {
+	std::vector< StaticCollision::Collider > colliders;
+	colliders.reserve(mesh_colliders.size());
+	for (auto const &c : mesh_colliders) {
+		colliders.emplace_back(StaticCollision::Collider{c.transform, c.mesh, c.buffer});
+	}
+	static_collision.build(colliders);
+}
+
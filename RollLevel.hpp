@@ -7,6 +7,7 @@
 
 #include "Scene.hpp"
 #include "Mesh.hpp"
+#include "StaticCollision.hpp"
 #include "Load.hpp"
 
 struct RollLevel;
@@ -55,6 +56,10 @@ struct RollLevel : Scene {
 
 	//Additional information for things in the level:
 	std::vector< MeshCollider > mesh_colliders;
+	//...the colliders' triangles in world space (built from mesh_colliders):
+	StaticCollision static_collision;
+	void build_static_collision();
+
 	std::vector< Goal > goals;
 	Player player;
 
@@ -13,12 +13,24 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 
 Load< SpriteAtlas > trade_font_atlas(LoadTagDefault, []() -> SpriteAtlas const * {
 	return new SpriteAtlas(data_path("trade-font"));
 });
 
+//transform taking the [-1,1]^3 cube to a box (as used by DrawLines::draw_box):
+static glm::mat4x3 box_to_world(CollisionBox const &box) {
+	return glm::mat4x3(
+		box.axes[0] * box.half_extents[0],
+		box.axes[1] * box.half_extents[1],
+		box.axes[2] * box.half_extents[2],
+		box.center
+	);
+}
+
 RollMode::RollMode(RollLevel const &level_) : start(level_), level(level_) {
 	restart();
 }
@@ -144,124 +156,170 @@ void RollMode::update(float elapsed) {
 
 		rotational_velocity *= std::pow(0.5f, elapsed / 2.0f);
 
-		if (DEBUG_fly) {
-			//DEBUG: fly mode -- no gravity:
-			velocity = glm::mix(shove, velocity, std::pow(0.5f, elapsed / 0.25f));
-		} else {
-			velocity = glm::vec3(
-				//decay existing velocity toward shove:
-				glm::mix(glm::vec2(shove), glm::vec2(velocity), std::pow(0.5f, elapsed / 0.25f)),
-				//also: gravity
-				velocity.z - 10.0f * elapsed
-			);
+		//collide against level:
+		// (level triangles are baked into world space; this only re-bakes if a collider moved)
+		if (level.static_collision.refresh()) nearby_valid = false;
+		CollisionWorld const &world = level.static_collision.world;
+		float sphere_radius = 1.0f; //player sphere is radius-1
+
+		//fastest the player can go this frame:
+		// (velocity heads toward shove, gravity adds at most 10*elapsed, and collisions never speed the player up)
+		float max_speed = glm::length(velocity) + glm::length(shove) + (DEBUG_fly ? 0.0f : 10.0f * elapsed);
+
+		{ //make sure the nearby triangles and boxes cover everywhere the player can reach this frame:
+			float reach = max_speed * elapsed + sphere_radius;
+			glm::vec3 reach_min = position - glm::vec3(reach);
+			glm::vec3 reach_max = position + glm::vec3(reach);
+			if (!nearby_valid
+			 || glm::any(glm::lessThan(reach_min, nearby_min))
+			 || glm::any(glm::greaterThan(reach_max, nearby_max))) {
+				std::chrono::high_resolution_clock::time_point before;
+				if (stats.timing) before = std::chrono::high_resolution_clock::now();
+				//gather with some slack, so the next few frames (e.g., of rolling slowly or resting on the floor) can reuse the same candidates:
+				constexpr float Slack = 0.5f;
+				nearby_min = reach_min - glm::vec3(Slack);
+				nearby_max = reach_max + glm::vec3(Slack);
+				nearby_triangles.clear();
+				world.gather(nearby_min, nearby_max, &nearby_triangles);
+				nearby_boxes.clear();
+				world.gather_boxes(nearby_min, nearby_max, &nearby_boxes);
+				nearby_valid = true;
+				DEBUG_nearby_lines_stale = true;
+				stats.gathers += 1;
+				if (stats.timing) stats.gather_seconds += std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+			}
 		}
 
-		//set up a new draw_lines object for DEBUG drawing:
-		if (!DEBUG_draw_lines) {
-			DEBUG_draw_lines.reset(new DrawLines(glm::mat4(1.0f)));
-		}
+		//fast motion is split into substeps of about a radius of travel, each with its own velocity update and contacts:
+		// (a resting or slowly rolling player takes one substep, which is the same as not substepping)
+		constexpr uint32_t MaxSubsteps = 4;
+		//collide-and-slide iterations are shared by all of a frame's substeps:
+		constexpr uint32_t IterationBudget = 16;
+		static_assert(IterationBudget >= MaxSubsteps, "every substep gets at least one iteration");
 
-		//collide against level:
-		float remain = elapsed;
-		for (int32_t iter = 0; iter < 10; ++iter) {
-			if (remain == 0.0f) break;
-
-			float sphere_radius = 1.0f; //player sphere is radius-1
-			glm::vec3 sphere_sweep_from = position;
-			glm::vec3 sphere_sweep_to = position + velocity * remain;
-
-			glm::vec3 sphere_sweep_min = glm::min(sphere_sweep_from, sphere_sweep_to) - glm::vec3(sphere_radius);
-			glm::vec3 sphere_sweep_max = glm::max(sphere_sweep_from, sphere_sweep_to) + glm::vec3(sphere_radius);
-
-			bool collided = false;
-			float collision_t = 1.0f;
-			glm::vec3 collision_at = glm::vec3(0.0f);
-			glm::vec3 collision_out = glm::vec3(0.0f);
-			for (auto const &collider : level.mesh_colliders) {
-				glm::mat4x3 collider_to_world = collider.transform->make_local_to_world();
-
-				{ //Early discard:
-					// check if AABB of collider overlaps AABB of swept sphere:
-
-					//(1) compute bounding box of collider in world space:
-					glm::vec3 local_center = 0.5f * (collider.mesh->max + collider.mesh->min);
-					glm::vec3 local_radius = 0.5f * (collider.mesh->max - collider.mesh->min);
-
-					glm::vec3 world_min = collider_to_world * glm::vec4(local_center, 1.0f)
-						- glm::abs(local_radius.x * collider_to_world[0])
-						- glm::abs(local_radius.y * collider_to_world[1])
-						- glm::abs(local_radius.z * collider_to_world[2]);
-					glm::vec3 world_max = collider_to_world * glm::vec4(local_center, 1.0f)
-						+ glm::abs(local_radius.x * collider_to_world[0])
-						+ glm::abs(local_radius.y * collider_to_world[1])
-						+ glm::abs(local_radius.z * collider_to_world[2]);
-
-					//(2) check if bounding boxes overlap:
-					bool can_skip = !collide_AABB_vs_AABB(sphere_sweep_min, sphere_sweep_max, world_min, world_max);
-
-					//draw to indicate result of check:
-					if (iter == 0 && DEBUG_draw_lines && DEBUG_show_geometry) {
-						DEBUG_draw_lines->draw_box(glm::mat4x3(
-							0.5f * (world_max.x - world_min.x), 0.0f, 0.0f,
-							0.0f, 0.5f * (world_max.y - world_min.y), 0.0f,
-							0.0f, 0.0f, 0.5f * (world_max.z - world_min.z),
-							0.5f * (world_max.x+world_min.x), 0.5f * (world_max.y+world_min.y), 0.5f * (world_max.z+world_min.z)
-						), (can_skip ? glm::u8vec4(0x88, 0x88, 0x88, 0xff) : glm::u8vec4(0x88, 0x88, 0x00, 0xff) ) );
-					}
+		float travel = max_speed * elapsed / sphere_radius;
+		uint32_t substeps = (travel < float(MaxSubsteps) ? std::max(1U, uint32_t(std::ceil(travel))) : MaxSubsteps);
+		float step = elapsed / float(substeps);
+		uint32_t iterations = 0;
+		bool out_of_budget = false;
 
-					if (can_skip) {
-						//AABBs do not overlap; skip detailed check:
-						continue;
-					}
-				}
+		for (uint32_t substep = 0; substep < substeps; ++substep) {
+			if (DEBUG_fly) {
+				//DEBUG: fly mode -- no gravity:
+				velocity = glm::mix(shove, velocity, std::pow(0.5f, step / 0.25f));
+			} else {
+				velocity = glm::vec3(
+					//decay existing velocity toward shove:
+					glm::mix(glm::vec2(shove), glm::vec2(velocity), std::pow(0.5f, step / 0.25f)),
+					//also: gravity
+					velocity.z - 10.0f * step
+				);
+			}
 
-				//Full (all triangles) test:
-				assert(collider.mesh->type == GL_TRIANGLES); //only have code for TRIANGLES not other primitive types
-				for (GLuint v = 0; v + 2 < collider.mesh->count; v += 3) {
-					//get vertex positions from associated positions buffer:
-					//  (and transform to world space)
-					glm::vec3 a = collider_to_world * glm::vec4(collider.buffer->positions[collider.mesh->start+v+0], 1.0f);
-					glm::vec3 b = collider_to_world * glm::vec4(collider.buffer->positions[collider.mesh->start+v+1], 1.0f);
-					glm::vec3 c = collider_to_world * glm::vec4(collider.buffer->positions[collider.mesh->start+v+2], 1.0f);
-					//check triangle:
-					bool did_collide = collide_swept_sphere_vs_triangle(
+			//(leave at least one iteration for each of the remaining substeps)
+			uint32_t budget = IterationBudget - iterations - (substeps - 1 - substep);
+
+			//surfaces touched during this substep; velocity is kept from pointing into any of them:
+			glm::vec3 contacts[2];
+			uint32_t contact_count = 0;
+
+			float remain = step;
+			for (uint32_t iter = 0; iter < budget; ++iter) {
+				//stopped (e.g., resting in a corner) -- nothing left to sweep:
+				if (remain == 0.0f || glm::length(velocity) * remain < 1e-6f) break;
+
+				glm::vec3 sphere_sweep_from = position;
+				glm::vec3 sphere_sweep_to = position + velocity * remain;
+
+				std::chrono::high_resolution_clock::time_point before;
+				if (stats.timing) before = std::chrono::high_resolution_clock::now();
+				float collision_t = 1.0f;
+				glm::vec3 collision_at = glm::vec3(0.0f);
+				glm::vec3 collision_out = glm::vec3(0.0f);
+				//check the nearby triangles all at once:
+				// (dense collision meshes get split across worker threads; results are the same either way)
+				uint32_t hit = collide_swept_sphere_vs_triangles_parallel(
+					sphere_sweep_from, sphere_sweep_to, sphere_radius,
+					nearby_triangles,
+					&collision_t, &collision_at, &collision_out);
+				//...then the boxes:
+				uint32_t hit_box = -1U;
+				for (uint32_t b : nearby_boxes) {
+					if (collide_swept_sphere_vs_box(
 						sphere_sweep_from, sphere_sweep_to, sphere_radius,
-						a,b,c,
-						&collision_t, &collision_at, &collision_out);
-
-					if (did_collide) {
-						collided = true;
+						world.boxes[b],
+						&collision_t, &collision_at, &collision_out)) {
+						hit = -1U;
+						hit_box = b;
 					}
-
-					//draw to indicate result of check:
-					if (iter == 0 && DEBUG_draw_lines) {
-						glm::u8vec4 color = (did_collide ? glm::u8vec4(0x88, 0x00, 0x00, 0xff) : glm::u8vec4(0x88, 0x88, 0x00, 0xff));
-						if (DEBUG_show_geometry || (did_collide && DEBUG_show_collision)) {
-							DEBUG_draw_lines->draw(a,b,color);
-							DEBUG_draw_lines->draw(b,c,color);
-							DEBUG_draw_lines->draw(c,a,color);
-						}
+				}
+				bool collided = (hit != -1U || hit_box != -1U);
+				stats.iterations += 1;
+				stats.triangle_tests += nearby_triangles.count;
+				stats.box_tests += nearby_boxes.size();
+				if (stats.timing) stats.sweep_seconds += std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+
+				//highlight the result of the frame's first check:
+				// (the rest of the nearby geometry is drawn from DEBUG_nearby_lines)
+				if (iterations == 0 && collided && (DEBUG_show_geometry || DEBUG_show_collision)) {
+					if (!DEBUG_draw_lines) DEBUG_draw_lines.reset(new DrawLines(glm::mat4(1.0f)));
+					glm::u8vec4 color = glm::u8vec4(0x88, 0x00, 0x00, 0xff);
+					if (hit != -1U) {
+						glm::vec3 a = nearby_triangles.a(hit);
+						glm::vec3 b = nearby_triangles.b(hit);
+						glm::vec3 c = nearby_triangles.c(hit);
+						DEBUG_draw_lines->draw(a,b,color);
+						DEBUG_draw_lines->draw(b,c,color);
+						DEBUG_draw_lines->draw(c,a,color);
 						//do a bit more to highlight colliding triangles (otherwise edges can be over-drawn by non-colliding triangles):
-						if (did_collide && DEBUG_show_collision) {
+						if (DEBUG_show_collision) {
 							glm::vec3 m = (a + b + c) / 3.0f;
 							DEBUG_draw_lines->draw(glm::mix(a,m,0.1f),glm::mix(b,m,0.1f),color);
 							DEBUG_draw_lines->draw(glm::mix(b,m,0.1f),glm::mix(c,m,0.1f),color);
 							DEBUG_draw_lines->draw(glm::mix(c,m,0.1f),glm::mix(a,m,0.1f),color);
 						}
+					} else {
+						DEBUG_draw_lines->draw_box(box_to_world(world.boxes[hit_box]), color);
 					}
 				}
-			}
+				iterations += 1;
+
+				if (!collided) {
+					position = sphere_sweep_to;
+					remain = 0.0f;
+					break;
+				}
 
-			if (!collided) {
-				position = sphere_sweep_to;
-				remain = 0.0f;
-				break;
-			} else {
 				position = glm::mix(sphere_sweep_from, sphere_sweep_to, collision_t);
 				float d = glm::dot(velocity, collision_out);
 				if (d < 0.0f) {
 					velocity -= (1.1f * d) * collision_out;
 
+					//a bounce off one surface can head into another one touched earlier in this substep;
+					// rather than spend iterations bouncing between them, slide along the crease where they meet,
+					// or stop if wedged between three surfaces:
+					for (uint32_t c = 0; c < contact_count; ++c) {
+						if (glm::dot(velocity, contacts[c]) >= 0.0f) continue;
+						glm::vec3 crease = glm::cross(contacts[c], collision_out);
+						float crease_length = glm::length(crease);
+						if (crease_length < 1e-3f) {
+							//(nearly the same surface, so the bounce just needs to clear both)
+							velocity -= glm::dot(velocity, contacts[c]) * contacts[c];
+						} else if (contact_count == 2) {
+							velocity = glm::vec3(0.0f);
+						} else {
+							crease /= crease_length;
+							velocity = glm::dot(velocity, crease) * crease;
+						}
+						break;
+					}
+					if (contact_count < 2) {
+						contacts[contact_count] = collision_out;
+						contact_count += 1;
+					} else {
+						contacts[1] = collision_out;
+					}
+
 					//update rotational velocity to reflect relative motion:
 					glm::vec3 slip = glm::cross(rotational_velocity, collision_at - position) + velocity;
 					//DEBUG: std::cout << "slip: " << slip.x << " " << slip.y << " " << slip.z << std::endl;
@@ -271,7 +329,8 @@ void RollMode::update(float elapsed) {
 					glm::vec3 change = glm::cross(slip, collision_at - position);
 					rotational_velocity += change;
 				}
-				if (DEBUG_draw_lines && DEBUG_show_collision) {
+				if (DEBUG_show_collision) {
+					if (!DEBUG_draw_lines) DEBUG_draw_lines.reset(new DrawLines(glm::mat4(1.0f)));
 					//draw a little gadget at the collision point:
 					glm::vec3 p1;
 					if (std::abs(collision_out.x) <= std::abs(collision_out.y) && std::abs(collision_out.x) <= std::abs(collision_out.z)) {
@@ -292,13 +351,13 @@ void RollMode::update(float elapsed) {
 					DEBUG_draw_lines->draw(collision_at - r*p2, collision_at + r*p1, color);
 					DEBUG_draw_lines->draw(collision_at, collision_at + collision_out, color);
 				}
-				/*if (iter == 0) {
-					std::cout << collision_out.x << ", " << collision_out.y << ", " << collision_out.z
-					<< " / " << velocity.x << ", " << velocity.y << ", " << velocity.z << std::endl; //DEBUG
-				}*/
 				remain = (1.0f - collision_t) * remain;
 			}
+			//(if the budget ran out, the player stays at its last contact -- never past it -- and the rest of the substep is dropped)
+			if (remain != 0.0f && glm::length(velocity) * remain >= 1e-6f) out_of_budget = true;
 		}
+		stats.substeps += substeps;
+		if (out_of_budget) stats.over_budget += 1;
 
 		//update player rotation (purely cosmetic):
 		rotation = glm::normalize(
@@ -309,6 +368,8 @@ void RollMode::update(float elapsed) {
 		);
 	}
 
+	stats.frames += 1;
+
 	//goal update:
 	for (auto &goal : level.goals) {
 		goal.spin_acc += elapsed / 10.0f;
@@ -376,7 +437,29 @@ void RollMode::draw(glm::uvec2 const &drawable_size) {
 
 	}
 
-	if (DEBUG_draw_lines) { //DEBUG drawing:
+	if (DEBUG_show_geometry) { //DEBUG drawing of the nearby geometry:
+		//(only re-uploaded when the nearby triangles and boxes are gathered again)
+		if (DEBUG_nearby_lines_stale) {
+			DrawLines lines(glm::mat4(1.0f));
+			glm::u8vec4 color = glm::u8vec4(0x88, 0x88, 0x00, 0xff);
+			for (uint32_t i = 0; i < nearby_triangles.count; ++i) {
+				glm::vec3 a = nearby_triangles.a(i);
+				glm::vec3 b = nearby_triangles.b(i);
+				glm::vec3 c = nearby_triangles.c(i);
+				lines.draw(a,b,color);
+				lines.draw(b,c,color);
+				lines.draw(c,a,color);
+			}
+			for (uint32_t b : nearby_boxes) {
+				lines.draw_box(box_to_world(level.static_collision.world.boxes[b]), color);
+			}
+			DEBUG_nearby_lines.set(&lines);
+			DEBUG_nearby_lines_stale = false;
+		}
+		DEBUG_nearby_lines.draw(level.camera->make_projection() * level.camera->transform->make_world_to_local());
+	}
+
+	if (DEBUG_draw_lines) { //DEBUG drawing of this frame's collisions:
 		//adjust world-to-clip matrix to current camera:
 		DEBUG_draw_lines->world_to_clip = level.camera->make_projection() * level.camera->transform->make_world_to_local();
 		//delete object (draws in destructor):
@@ -390,4 +473,6 @@ void RollMode::draw(glm::uvec2 const &drawable_size) {
 void RollMode::restart() {
 	level = start;
 	won = false;
+	nearby_valid = false;
+	DEBUG_nearby_lines_stale = true;
 }
@@ -3,6 +3,7 @@
 #include "Mode.hpp"
 #include "RollLevel.hpp"
 #include "DrawLines.hpp"
+#include "collide.hpp"
 
 #include <memory>
 
@@ -22,6 +23,30 @@ struct RollMode : Mode {
 	RollLevel level;
 	bool won = false;
 
+	//level triangles and boxes near the player:
+	// gathered for the region [nearby_min, nearby_max] (which has some slack around the player's reach),
+	// and reused by every collision iteration of every frame until the player might leave that region.
+	PackedTriangles nearby_triangles;
+	std::vector< uint32_t > nearby_boxes;
+	glm::vec3 nearby_min = glm::vec3(0.0f);
+	glm::vec3 nearby_max = glm::vec3(0.0f);
+	bool nearby_valid = false; //cleared on restart or when the level's collision is re-baked
+
+	//work done by update()'s collide-and-slide, accumulated until cleared (e.g., by bench-roll):
+	struct Stats {
+		uint32_t frames = 0;
+		uint32_t substeps = 0; //motion is split into substeps when moving fast
+		uint32_t iterations = 0; //collide-and-slide iterations (sweeps)
+		uint32_t over_budget = 0; //frames that ran out of iterations with motion left over
+		uint64_t triangle_tests = 0; //triangles swept against, summed over iterations
+		uint64_t box_tests = 0; //boxes swept against, summed over iterations
+		uint32_t gathers = 0; //times the nearby triangles and boxes were gathered again
+		//reading the clock around every gather and sweep isn't free, so it's only done when asked for:
+		bool timing = false;
+		double gather_seconds = 0.0;
+		double sweep_seconds = 0.0; //time spent in the sweeps themselves
+	} stats;
+
 	//Current control signals:
 	struct {
 		bool forward = false;
@@ -35,6 +60,9 @@ struct RollMode : Mode {
 	bool DEBUG_show_geometry = false;
 	bool DEBUG_show_collision = false;
 
-	//some debug drawing done during update:
+	//some debug drawing done during update (only made when there is something to show):
 	std::unique_ptr< DrawLines > DEBUG_draw_lines;
+	//wireframe of the nearby triangles and boxes (rebuilt by draw() after they are gathered again):
+	RetainedLines DEBUG_nearby_lines;
+	bool DEBUG_nearby_lines_stale = true;
 };
@@ -1,11 +1,16 @@
 #include "Scene.hpp"
 
+#include "FrameProfiler.hpp"
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
 
 //-------------------------
 
@@ -75,34 +80,160 @@ void Scene::draw(Camera const &camera) const {
 	draw(world_to_clip, world_to_light);
 }
 
+//sort key for a drawable's depth:
+// (positive floats order the same as their bit patterns, so keeping the top 16 bits gives
+//  a log-spaced quantization with 7 bits of mantissa per power of two)
+static uint32_t quantize_depth(float depth) {
+	if (!(depth > 0.0f)) return 0; //at or behind the eye (or NaN): draw first
+	uint32_t bits;
+	static_assert(sizeof(bits) == sizeof(depth), "float is 32 bits");
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return bits >> 16;
+}
+
+//stable LSD radix sort of 'values' by their upper 32 bits:
+static void radix_sort_by_high_bits(std::vector< uint64_t > *values_, std::vector< uint64_t > *temp_) {
+	assert(values_);
+	assert(temp_);
+	auto &values = *values_;
+	auto &temp = *temp_;
+	if (values.size() < 2) return;
+	temp.resize(values.size());
+	for (uint32_t shift = 32; shift < 64; shift += 8) {
+		uint32_t offsets[256] = { 0 };
+		for (uint64_t v : values) {
+			offsets[(v >> shift) & 0xff] += 1;
+		}
+		//skip passes where every value has the same digit:
+		if (offsets[(values[0] >> shift) & 0xff] == values.size()) continue;
+		uint32_t total = 0;
+		for (uint32_t d = 0; d < 256; ++d) {
+			uint32_t count = offsets[d];
+			offsets[d] = total;
+			total += count;
+		}
+		for (uint64_t v : values) {
+			temp[offsets[(v >> shift) & 0xff]++] = v;
+		}
+		values.swap(temp);
+	}
+}
+
+//level of detail for a given projected radius, with no hysteresis:
+static uint32_t lod_for_radius(float projected_radius, float lod_radius, uint32_t levels) {
+	if (!(projected_radius < lod_radius)) return 0; //(also catches NaN)
+	if (!(projected_radius > 0.0f)) return levels;
+	//one level per halving of radius:
+	float halvings = std::log2(lod_radius / projected_radius);
+	return uint32_t(std::min(float(levels), 1.0f + std::floor(halvings)));
+}
+
 void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+	FrameProfiler::Scope profile("Scene::draw");
 
-	//Iterate through all drawables, sending each one to OpenGL:
-	for (auto const &drawable : drawables) {
-		//Reference to drawable's pipeline for convenience:
-		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+	//NDC radius of a world-space sphere is its radius times the length of the first three entries of
+	// the clip-space y row, divided by clip w (this is exact for perspective projections of the sort Camera makes):
+	float clip_y_scale = glm::length(glm::vec3(world_to_clip[0][1], world_to_clip[1][1], world_to_clip[2][1]));
 
+	//Gather everything that will actually be drawn:
+	struct DrawItem {
+		Drawable const *drawable;
+		glm::mat4 object_to_world;
+		GLuint start, count; //vertex range (which depends on level of detail)
+	};
+	std::vector< DrawItem > items;
+	items.reserve(drawables.size());
+	for (auto const &drawable : drawables) {
 		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
+		if (drawable.pipeline.program == 0) continue;
 		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
+		if (drawable.pipeline.count == 0) continue;
 
+		assert(drawable.transform); //drawables *must* have a transform
+		items.emplace_back(DrawItem{ &drawable, drawable.transform->make_local_to_world(), drawable.pipeline.start, drawable.pipeline.count });
+		DrawItem &item = items.back();
+
+		//pick a level of detail:
+		if (drawable.mesh && !drawable.mesh->lods.empty()) {
+			Mesh const &mesh = *drawable.mesh;
+			uint32_t levels = uint32_t(mesh.lods.size());
+
+			glm::vec3 center = item.object_to_world * glm::vec4(0.5f * (mesh.min + mesh.max), 1.0f);
+			float scale = std::max(glm::length(glm::vec3(item.object_to_world[0])),
+				std::max(glm::length(glm::vec3(item.object_to_world[1])), glm::length(glm::vec3(item.object_to_world[2]))));
+			float w = (world_to_clip * glm::vec4(center, 1.0f)).w;
+			//(bounding spheres reaching behind the eye are drawn at full detail)
+			float projected_radius = (w > mesh.radius * scale ? mesh.radius * scale * clip_y_scale / w : std::numeric_limits< float >::infinity());
+
+			//only change level when the radius is clearly past a switch point:
+			uint32_t finest = lod_for_radius(projected_radius * (1.0f + lod_hysteresis), lod_radius, levels);
+			uint32_t coarsest = lod_for_radius(projected_radius * (1.0f - lod_hysteresis), lod_radius, levels);
+			drawable.lod = std::max(finest, std::min(coarsest, drawable.lod));
+
+			if (drawable.lod > 0) {
+				item.start = mesh.lods[drawable.lod - 1].start;
+				item.count = mesh.lods[drawable.lod - 1].count;
+			}
+		}
+	}
+
+	//Build an order to draw them in:
+	std::vector< uint64_t > order; //[ 16 bits depth | 16 bits state | 32 bits item index ]
+	order.reserve(items.size());
+	if (sort_front_to_back) {
+		//state ids are handed out in order of first appearance:
+		std::unordered_map< uint64_t, uint32_t > state_ids;
+		for (uint32_t i = 0; i < uint32_t(items.size()); ++i) {
+			Drawable::Pipeline const &pipeline = items[i].drawable->pipeline;
+			uint64_t state = (uint64_t(pipeline.program) << 32) | uint64_t(pipeline.vao);
+			uint32_t state_id = state_ids.emplace(state, uint32_t(state_ids.size())).first->second;
+
+			//clip-space w is view-space distance along the view direction:
+			float depth = (world_to_clip * items[i].object_to_world[3]).w;
+
+			uint32_t key = (quantize_depth(depth) << 16) | std::min(state_id, 0xffffU);
+			order.emplace_back((uint64_t(key) << 32) | uint64_t(i));
+		}
+		std::vector< uint64_t > temp;
+		radix_sort_by_high_bits(&order, &temp);
+	} else {
+		for (uint32_t i = 0; i < uint32_t(items.size()); ++i) {
+			order.emplace_back(uint64_t(i));
+		}
+	}
+
+	//Send each item to OpenGL:
+	//(program and vao binds are only issued when they change; -1U forces the first bind)
+	GLuint bound_program = -1U;
+	GLuint bound_vao = -1U;
+	for (uint64_t o : order) {
+		DrawItem const &item = items[uint32_t(o)];
+		//Reference to drawable's pipeline for convenience:
+		Scene::Drawable::Pipeline const &pipeline = item.drawable->pipeline;
 
 		//Set shader program:
-		glUseProgram(pipeline.program);
+		if (pipeline.program != bound_program) {
+			glUseProgram(pipeline.program);
+			bound_program = pipeline.program;
+		}
 
 		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+		if (pipeline.vao != bound_vao) {
+			glBindVertexArray(pipeline.vao);
+			bound_vao = pipeline.vao;
+		}
 
 		//Configure program uniforms:
 
 		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4 object_to_world = drawable.transform->make_local_to_world();
+		glm::mat4 const &object_to_world = item.object_to_world;
+
+		//(Position attributes may need decoding to object space first; normals don't)
+		glm::mat4 position_to_world = object_to_world * pipeline.position_to_object;
 
 		//OBJECT_TO_CLIP takes vertices from object space to clip space:
 		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
+			glm::mat4 object_to_clip = world_to_clip * position_to_world;
 			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
 		}
 
@@ -111,7 +242,8 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 
 		//OBJECT_TO_CLIP takes vertices from object space to light space:
 		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+			glm::mat4x3 position_to_light = world_to_light * position_to_world;
+			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(position_to_light));
 		}
 
 		//NORMAL_TO_CLIP takes normals from object space to light space:
@@ -132,7 +264,12 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 		}
 
 		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		if (pipeline.index_type == GL_NONE) {
+			glDrawArrays(pipeline.type, item.start, item.count);
+		} else {
+			GLsizei index_size = (pipeline.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+			glDrawElements(pipeline.type, item.count, pipeline.index_type, (GLbyte *)0 + item.start * index_size);
+		}
 
 		//un-bind textures:
 		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
@@ -155,10 +292,11 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	MappedFile file(filename);
+	size_t offset = 0;
 
-	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	ChunkSpan< char > names;
+	read_chunk(file, &offset, "str0", &names);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -169,8 +307,8 @@ void Scene::load(std::string const &filename,
 		glm::vec3 scale;
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
-	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	ChunkSpan< HierarchyEntry > hierarchy;
+	read_chunk(file, &offset, "xfh0", &hierarchy);
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -178,8 +316,8 @@ void Scene::load(std::string const &filename,
 		uint32_t name_end;
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
-	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	ChunkSpan< MeshEntry > meshes;
+	read_chunk(file, &offset, "msh0", &meshes);
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -188,8 +326,8 @@ void Scene::load(std::string const &filename,
 		float clip_near, clip_far;
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
-	std::vector< CameraEntry > cameras;
-	read_chunk(file, "cam0", &cameras);
+	ChunkSpan< CameraEntry > cameras;
+	read_chunk(file, &offset, "cam0", &cameras);
 
 	struct LightEntry {
 		uint32_t transform;
@@ -200,10 +338,10 @@ void Scene::load(std::string const &filename,
 		float fov;
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
-	std::vector< LightEntry > lamps;
-	read_chunk(file, "lmp0", &lamps);
+	ChunkSpan< LightEntry > lamps;
+	read_chunk(file, &offset, "lmp0", &lamps);
 
-	if (file.peek() != EOF) {
+	if (offset != file.size) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -13,6 +13,7 @@
  */
 
 #include "GL.hpp"
+#include "Mesh.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -65,6 +66,12 @@ struct Scene {
 			GLenum type = GL_TRIANGLES; //what sort of primitive to draw; passed to glDrawArrays
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
+			//if set, draw with glDrawElements from the vao's element buffer instead, treating start and count as an index range:
+			GLenum index_type = GL_NONE; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+			//takes Position attribute values to object space, for quantized positions (see Mesh::position_to_object):
+			// (applied before OBJECT_TO_CLIP and OBJECT_TO_LIGHT, but not NORMAL_TO_LIGHT)
+			glm::mat4 position_to_object = glm::mat4(1.0f);
 
 			//uniforms:
 			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
@@ -79,6 +86,11 @@ struct Scene {
 				GLenum target = GL_TEXTURE_2D;
 			} textures[TextureCount];
 		} pipeline;
+
+		//(optional) mesh being drawn; if it has levels of detail, draw() will pick one by
+		// projected size and use its vertex range in place of pipeline.start/count:
+		Mesh const *mesh = nullptr;
+		mutable uint32_t lod = 0; //level of detail last drawn (0 == full detail); kept for hysteresis
 	};
 
 	struct Camera {
@@ -124,6 +136,19 @@ struct Scene {
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
 	void draw(Camera const &camera) const;
 
+	//By default, drawables are drawn in list order.
+	// Setting this sorts them front-to-back (by the view depth of their origin, then by program/vao)
+	// so that early depth testing can reject more hidden fragments.
+	// NOTE: this assumes every drawable is opaque.
+	bool sort_front_to_back = false;
+
+	//Level of detail selection for drawables with a mesh that has lower levels:
+	// the first lower level is used once the bounding sphere's projected radius drops below
+	// lod_radius (in NDC, so 1.0 == half the viewport height), and each further level at half that:
+	float lod_radius = 0.2f;
+	// switch points are widened by this fraction in each direction so that levels don't flicker:
+	float lod_hysteresis = 0.15f;
+
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
 	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
 
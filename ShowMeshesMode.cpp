@@ -161,6 +161,8 @@ void ShowMeshesMode::select_prev_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
+		scene_drawable->pipeline.position_to_object = f->second.position_to_object;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
@@ -190,6 +192,8 @@ void ShowMeshesMode::select_next_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
+		scene_drawable->pipeline.position_to_object = f->second.position_to_object;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
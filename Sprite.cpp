@@ -4,27 +4,17 @@
 #include "read_write_chunk.hpp"
 #include "load_save_png.hpp"
 
-#include <fstream>
 
 SpriteAtlas::SpriteAtlas(std::string const &filebase) {
 	std::string png_path = filebase + ".png";
 	atlas_path = filebase + ".atlas";
 
-	// ----- load the texture data -----
-	std::vector< glm::u8vec4 > tex_data;
-	load_png(png_path, &tex_size, &tex_data, LowerLeftOrigin);
-
-	//upload the texture data to the GPU:
-
 	//generate a new texture object name:
 	glGenTextures(1, &tex);
 
 	//bind the new texture object:
 	glBindTexture(GL_TEXTURE_2D, tex);
 
-	//upload pixel data:
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_size.x, tex_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_data.data());
-
 	//set filtering and wrapping parameters:
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -41,16 +31,32 @@ SpriteAtlas::SpriteAtlas(std::string const &filebase) {
 	//unbind the texture object:
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	//read the files on a worker thread and stream the texture data to 'tex':
+	// (lookup() waits for the files to be read)
+	loading = UploadQueue::submit([this,png_path](UploadQueue::Uploads *uploads) {
+		load(png_path, uploads);
+	});
+}
+
+void SpriteAtlas::load(std::string const &png_path, UploadQueue::Uploads *uploads) {
+	// ----- load the texture data -----
+	uploads->textures.emplace_back();
+	UploadQueue::TextureUpload &tex_upload = uploads->textures.back();
+	tex_upload.tex = tex;
+	load_png(png_path, &tex_size, &tex_upload.data, LowerLeftOrigin);
+	tex_upload.size = tex_size;
+
 	// ----- load the sprite location data -----
 
-	//read from atlas_path in binary mode:
-	std::ifstream in(atlas_path, std::ios::binary);
+	//map atlas_path into memory:
+	MappedFile in(atlas_path);
+	size_t offset = 0;
 
 	//sprite atlas is stored as two chunks:
 	// (1) a 'str0' chunk with string data:
-	std::vector< char > strings;
+	ChunkSpan< char > strings;
 
-	read_chunk(in, "str0", &strings);
+	read_chunk(in, &offset, "str0", &strings);
 
 	// (2) a 'spr0' chunk with sprite data:
 	struct SpriteData {
@@ -59,9 +65,9 @@ SpriteAtlas::SpriteAtlas(std::string const &filebase) {
 		glm::vec2 max_px;
 		glm::vec2 anchor_px;
 	};
-	std::vector< SpriteData > datas;
+	ChunkSpan< SpriteData > datas;
 
-	read_chunk(in, "spr0", &datas);
+	read_chunk(in, &offset, "spr0", &datas);
 
 	//actually create Sprite objects from the data and insert into the lookup table:
 
@@ -92,11 +98,22 @@ SpriteAtlas::SpriteAtlas(std::string const &filebase) {
 }
 
 SpriteAtlas::~SpriteAtlas() {
+	//the loading job refers to this atlas, so let it finish first:
+	try {
+		UploadQueue::wait_uploaded(loading);
+	} catch (std::exception &) {
+		//(the error was the loader's to report)
+	}
 	glDeleteTextures(1, &tex);
 	tex = 0;
 }
 
+void SpriteAtlas::wait() const {
+	UploadQueue::wait_loaded(loading);
+}
+
 Sprite const &SpriteAtlas::lookup(std::string const &name) const {
+	wait();
 	auto f = sprites.find(name);
 	if (f == sprites.end()) {
 		throw std::runtime_error("Sprite of name '" + name + "' not found in atlas '" + atlas_path + "'.");
@@ -8,6 +8,7 @@
  */
 
 #include "GL.hpp"
+#include "UploadQueue.hpp"
 
 #include <glm/glm.hpp>
 
@@ -31,11 +32,16 @@ struct Sprite {
 
 struct SpriteAtlas {
 	//load from filebase.png and filebase.atlas:
+	// (files are read and uploaded through the UploadQueue)
 	SpriteAtlas(std::string const &filebase);
 	~SpriteAtlas();
 
+	//wait for the files to be read; until then, only 'tex' and 'atlas_path' are valid:
+	// throws an error if loading failed
+	void wait() const;
+
 	//look up sprite in list of loaded sprites:
-	// throws an error if name is missing
+	// waits for the files to be read; throws an error if name is missing
 	Sprite const &lookup(std::string const &name) const;
 
 	//this is the atlas texture; used when drawing sprites:
@@ -49,5 +55,10 @@ struct SpriteAtlas {
 
 	//path to atlas, stored for debugging purposes:
 	std::string atlas_path;
+
+	//reading / uploading of the files:
+	UploadQueue::Ticket loading;
+	//(runs on a worker thread)
+	void load(std::string const &png_path, UploadQueue::Uploads *uploads);
 };
 
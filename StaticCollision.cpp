@@ -0,0 +1,91 @@
+#include "StaticCollision.hpp"
+
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+void StaticCollision::build(std::vector< Collider > const &colliders_) {
+	colliders = colliders_;
+	bake();
+}
+
+bool StaticCollision::refresh() {
+	for (auto const &state : baked_states) {
+		Scene::Transform const &t = *state.transform;
+		if (t.position != state.position || t.rotation != state.rotation || t.scale != state.scale || t.parent != state.parent) {
+			bake();
+			return true;
+		}
+	}
+	return false;
+}
+
+void StaticCollision::bake() {
+	baked_states.clear();
+
+	std::vector< glm::vec3 > positions;
+	std::vector< uint32_t > indices;
+	std::vector< CollisionBox > boxes;
+
+	//box-shaped meshes (local bounds), or not (empty bounds):
+	std::unordered_map< Mesh const *, std::pair< glm::vec3, glm::vec3 > > mesh_boxes;
+
+	std::unordered_set< Scene::Transform const * > recorded;
+	std::vector< uint32_t > buffer_to_world;
+	for (auto const &collider : colliders) {
+		assert(collider.transform && collider.mesh && collider.buffer);
+		assert(collider.mesh->type == GL_TRIANGLES); //only have code for TRIANGLES not other primitive types
+
+		//remember the state of the transform and its parents:
+		for (Scene::Transform const *t = collider.transform; t; t = t->parent) {
+			if (!recorded.insert(t).second) break; //(rest of chain already recorded)
+			baked_states.emplace_back(TransformState{t, t->position, t->rotation, t->scale, t->parent});
+		}
+
+		glm::mat4x3 collider_to_world = collider.transform->make_local_to_world();
+		std::vector< glm::vec3 > const &local_positions = collider.buffer->collision_positions;
+		std::vector< uint32_t > const &local_indices = collider.buffer->collision_indices;
+
+		//box-shaped meshes become a single box, as long as the transform doesn't shear them:
+		auto found = mesh_boxes.find(collider.mesh);
+		if (found == mesh_boxes.end()) {
+			std::pair< glm::vec3, glm::vec3 > bounds(glm::vec3(0.0f), glm::vec3(0.0f));
+			triangles_form_box(local_positions, local_indices, collider.mesh->collision_start, collider.mesh->collision_count, &bounds.first, &bounds.second);
+			found = mesh_boxes.emplace(collider.mesh, bounds).first;
+		}
+		if (found->second.first != found->second.second) {
+			glm::vec3 const &min = found->second.first;
+			glm::vec3 const &max = found->second.second;
+			CollisionBox box;
+			box.center = collider_to_world * glm::vec4(0.5f * (min + max), 1.0f);
+			glm::vec3 half[3];
+			for (uint32_t i = 0; i < 3; ++i) {
+				half[i] = collider_to_world[i] * (0.5f * (max[i] - min[i]));
+				box.half_extents[i] = glm::length(half[i]);
+				box.axes[i] = half[i] / box.half_extents[i];
+			}
+			float skew = std::max(std::abs(glm::dot(box.axes[0], box.axes[1])), std::max(std::abs(glm::dot(box.axes[1], box.axes[2])), std::abs(glm::dot(box.axes[2], box.axes[0]))));
+			if (skew < 1e-4f) {
+				boxes.emplace_back(box);
+				continue;
+			}
+		}
+
+		//transform each vertex used by the collider's triangles once:
+		buffer_to_world.assign(local_positions.size(), -1U);
+		for (GLuint v = 0; v + 2 < collider.mesh->collision_count; v += 3) {
+			for (uint32_t i = 0; i < 3; ++i) {
+				uint32_t local = local_indices[collider.mesh->collision_start + v + i];
+				if (buffer_to_world[local] == -1U) {
+					buffer_to_world[local] = uint32_t(positions.size());
+					positions.emplace_back(collider_to_world * glm::vec4(local_positions[local], 1.0f));
+				}
+				indices.emplace_back(buffer_to_world[local]);
+			}
+		}
+	}
+
+	world.build(positions, indices, boxes);
+}
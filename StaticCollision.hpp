@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * StaticCollision holds the triangles of a set of (mostly) non-moving mesh
+ *  colliders, transformed into world space once and handed to a CollisionWorld
+ *  (which indexes them with a TriangleBVH), so collision queries don't need to
+ *  transform anything.
+ * Colliders whose meshes are boxes (see triangles_form_box) are handed over as
+ *  oriented boxes instead, which take one test rather than twelve.
+ *
+ * If a collider's transform (or one of its parents) changes, refresh() re-bakes.
+ */
+
+#include "Scene.hpp"
+#include "Mesh.hpp"
+#include "CollisionWorld.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+struct StaticCollision {
+	//a collider is a mesh's collision triangles placed in the world by a transform:
+	struct Collider {
+		Scene::Transform const *transform;
+		Mesh const *mesh;
+		MeshBuffer const *buffer;
+	};
+
+	//replace all colliders and bake them:
+	void build(std::vector< Collider > const &colliders);
+
+	//re-bake if any collider's transform (or parent transform) changed since the last bake:
+	// returns true if anything was re-baked.
+	bool refresh();
+
+	//world-space triangles (and queries against them):
+	CollisionWorld world;
+
+	//-- internals --
+	std::vector< Collider > colliders;
+
+	//transform values when last baked (for every transform that affects a collider):
+	struct TransformState {
+		Scene::Transform const *transform;
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+		Scene::Transform const *parent;
+	};
+	std::vector< TransformState > baked_states;
+
+	void bake();
+};
@@ -0,0 +1,94 @@
+#include "TriangleBVH.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cassert>
+
+TriangleBVH::TriangleBVH(std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, uint32_t first, uint32_t count) {
+	if (uint64_t(first) + count > indices.size()) {
+		throw std::runtime_error("TriangleBVH index range doesn't fit index list.");
+	}
+
+	uint32_t triangle_count = count / 3;
+	if (triangle_count == 0) return;
+
+	//per-triangle bounds and centroids:
+	struct Triangle {
+		glm::vec3 min, max, centroid;
+		uint32_t offset;
+	};
+	std::vector< Triangle > tris;
+	tris.reserve(triangle_count);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		uint32_t offset = first + 3 * t;
+		glm::vec3 const &a = positions.at(indices[offset+0]);
+		glm::vec3 const &b = positions.at(indices[offset+1]);
+		glm::vec3 const &c = positions.at(indices[offset+2]);
+		tris.emplace_back();
+		Triangle &tri = tris.back();
+		tri.min = glm::min(a, glm::min(b, c));
+		tri.max = glm::max(a, glm::max(b, c));
+		tri.centroid = 0.5f * (tri.min + tri.max);
+		tri.offset = offset;
+	}
+
+	nodes.reserve(2 * (triangle_count / LeafSize + 1));
+	nodes.emplace_back();
+
+	//build top-down, splitting each node at the median centroid along its widest centroid axis:
+	struct Todo {
+		uint32_t node;
+		uint32_t begin, end; //range in 'tris'
+		uint32_t depth;
+	};
+	std::vector< Todo > todo;
+	todo.emplace_back(Todo{0, 0, triangle_count, 0});
+	while (!todo.empty()) {
+		Todo at = todo.back();
+		todo.pop_back();
+
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		glm::vec3 centroid_min = min;
+		glm::vec3 centroid_max = max;
+		for (uint32_t i = at.begin; i < at.end; ++i) {
+			min = glm::min(min, tris[i].min);
+			max = glm::max(max, tris[i].max);
+			centroid_min = glm::min(centroid_min, tris[i].centroid);
+			centroid_max = glm::max(centroid_max, tris[i].centroid);
+		}
+		nodes[at.node].min = min;
+		nodes[at.node].max = max;
+
+		//(depth limit keeps for_each_overlapping's stack from overflowing; medians make it unreachable in practice)
+		if (at.end - at.begin <= LeafSize || at.depth + 1 >= 60) {
+			nodes[at.node].first = uint32_t(triangles.size());
+			nodes[at.node].count = at.end - at.begin;
+			for (uint32_t i = at.begin; i < at.end; ++i) {
+				triangles.emplace_back(tris[i].offset);
+			}
+			continue;
+		}
+
+		glm::vec3 extent = centroid_max - centroid_min;
+		uint32_t axis = 0;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		uint32_t mid = at.begin + (at.end - at.begin) / 2;
+		std::nth_element(tris.begin() + at.begin, tris.begin() + mid, tris.begin() + at.end, [axis](Triangle const &a, Triangle const &b) {
+			return a.centroid[axis] < b.centroid[axis];
+		});
+
+		uint32_t child = uint32_t(nodes.size());
+		nodes[at.node].first = child;
+		nodes[at.node].count = 0;
+		nodes.emplace_back();
+		nodes.emplace_back();
+		todo.emplace_back(Todo{child + 1, mid, at.end, at.depth + 1});
+		todo.emplace_back(Todo{child, at.begin, mid, at.depth + 1});
+	}
+
+	assert(triangles.size() == triangle_count);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ * A TriangleBVH is a bounding volume hierarchy over the triangles of an
+ *  indexed triangle list, used to find the few triangles near a query box
+ *  (e.g., the bounds of a swept sphere) without testing all of them.
+ *
+ * Triangles are identified by the offset of their first index in the index list.
+ */
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct TriangleBVH {
+	TriangleBVH() = default;
+
+	//build over triangles positions[indices[first + 3*t + i]] for t in [0, count / 3):
+	TriangleBVH(std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, uint32_t first, uint32_t count);
+
+	//call fn(index_offset) for every triangle in a leaf whose bounds overlap [min, max]:
+	// (this includes every triangle that could touch the box, and a few nearby that don't)
+	template< typename F >
+	void for_each_overlapping(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const;
+
+	//call fn(node) for every leaf node whose bounds overlap [min, max]:
+	// (for sharing one traversal between several nearby queries)
+	template< typename F >
+	void for_each_overlapping_leaf(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const;
+
+	bool empty() const { return nodes.empty(); }
+
+	//-- internals --
+
+	//maximum triangles per leaf:
+	static constexpr uint32_t LeafSize = 4;
+
+	struct Node {
+		glm::vec3 min;
+		uint32_t first; //leaf: first entry in 'triangles'; interior: index of first child (second child follows it)
+		glm::vec3 max;
+		uint32_t count; //leaf: number of entries in 'triangles'; interior: 0
+	};
+	static_assert(sizeof(Node) == 32, "Node is packed.");
+
+	std::vector< Node > nodes; //nodes[0] is the root
+	std::vector< uint32_t > triangles; //index offsets of triangles, grouped by leaf
+};
+
+template< typename F >
+void TriangleBVH::for_each_overlapping(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const {
+	for_each_overlapping_leaf(min, max, [this, &fn](Node const &leaf) {
+		for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) {
+			fn(triangles[i]);
+		}
+	});
+}
+
+template< typename F >
+void TriangleBVH::for_each_overlapping_leaf(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const {
+	if (nodes.empty()) return;
+
+	auto overlaps = [&min, &max](Node const &node) {
+		return !(node.max.x < min.x || node.min.x > max.x
+		      || node.max.y < min.y || node.min.y > max.y
+		      || node.max.z < min.z || node.min.z > max.z);
+	};
+
+	//(trees are balanced, so depth is about log2(triangles / LeafSize))
+	uint32_t stack[64];
+	uint32_t top = 0;
+	if (overlaps(nodes[0])) stack[top++] = 0;
+	while (top) {
+		Node const &node = nodes[stack[--top]];
+		if (node.count) {
+			fn(node);
+		} else {
+			if (overlaps(nodes[node.first + 1])) stack[top++] = node.first + 1;
+			if (overlaps(nodes[node.first])) stack[top++] = node.first;
+		}
+	}
+}
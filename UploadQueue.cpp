@@ -0,0 +1,386 @@
+#include "UploadQueue.hpp"
+
+#include "gl_errors.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+struct UploadQueue::Job {
+	std::function< void(Uploads *) > load;
+
+	//written by the worker thread before 'loaded' is set:
+	Uploads uploads;
+	std::exception_ptr error;
+
+	bool loaded = false; //guarded by 'mutex'
+
+	//GL thread only:
+	bool error_reported = false;
+	size_t item = 0; //next buffer (or, after all buffers, texture) to copy
+	size_t done = 0; //bytes (for buffers) or rows (for textures) of the current item already copied
+	GLsync fence = 0; //set once all copies have been issued
+	bool uploaded = false;
+};
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+using UploadQueue::Ticket;
+
+//staging buffers are reused round-robin, each guarded by a fence:
+constexpr uint32_t StagingCount = 4;
+constexpr size_t StagingSize = 1 << 20;
+
+struct Staging {
+	GLuint buffer = 0;
+	size_t size = 0;
+	GLsync fence = 0;
+};
+
+bool running = false;
+
+//shared with worker threads:
+std::mutex mutex;
+std::condition_variable work_cv; //signalled when 'to_load' grows or 'stopping' is set
+std::condition_variable loaded_cv; //signalled when a job finishes loading
+std::deque< Ticket > to_load;
+bool stopping = false;
+std::vector< std::thread > workers;
+
+//GL thread only:
+std::deque< Ticket > to_upload; //submitted, copies not all issued yet (in submission order)
+std::deque< Ticket > in_flight; //copies issued, waiting on fence (in fence order)
+Staging staging[StagingCount];
+uint32_t next_staging = 0;
+
+void worker() {
+	while (true) {
+		Ticket job;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			work_cv.wait(lock, [](){ return stopping || !to_load.empty(); });
+			if (stopping) return;
+			job = to_load.front();
+			to_load.pop_front();
+		}
+		try {
+			job->load(&job->uploads);
+		} catch (...) {
+			job->error = std::current_exception();
+		}
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			job->load = nullptr;
+			job->loaded = true;
+		}
+		loaded_cv.notify_all();
+	}
+}
+
+bool is_loaded(Ticket const &job) {
+	std::unique_lock< std::mutex > lock(mutex);
+	return job->loaded;
+}
+
+//check (or, if 'wait', wait for) a fence; returns true once it has signalled:
+bool fence_signalled(GLsync fence, bool wait) {
+	if (!wait) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+	}
+	while (true) {
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) return true;
+		if (result == GL_WAIT_FAILED) throw std::runtime_error("glClientWaitSync failed while uploading.");
+	}
+}
+
+//get the next staging buffer (holding at least 'size' bytes), bound to 'target' and mapped:
+// returns nullptr if the buffer is still in use and !wait.
+void *map_staging(GLenum target, size_t size, bool wait) {
+	Staging &s = staging[next_staging];
+	if (s.fence) {
+		if (!fence_signalled(s.fence, wait)) return nullptr;
+		glDeleteSync(s.fence);
+		s.fence = 0;
+	}
+	if (s.buffer == 0) glGenBuffers(1, &s.buffer);
+	glBindBuffer(target, s.buffer);
+	if (s.size < size) {
+		s.size = std::max(size, StagingSize);
+		glBufferData(target, s.size, nullptr, GL_STREAM_DRAW);
+	}
+	//(the fence says the GPU is done reading, so no need for the driver to synchronize)
+	void *ptr = glMapBufferRange(target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!ptr) throw std::runtime_error("Failed to map staging buffer.");
+	return ptr;
+}
+
+//unmap the staging buffer bound to 'target':
+void unmap_staging(GLenum target) {
+	if (glUnmapBuffer(target) == GL_FALSE) {
+		//contents were lost (rare; e.g., on a display mode change) -- nothing reasonable to do but carry on:
+		std::cerr << "WARNING: staging buffer contents were lost during upload." << std::endl;
+	}
+}
+
+//fence the copy that was just issued from the current staging buffer and move to the next one:
+void fence_staging() {
+	staging[next_staging].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	next_staging = (next_staging + 1) % StagingCount;
+}
+
+//issue the copies for 'job' until finished (returns true), out of time, or (if !wait) out of free staging buffers:
+bool issue(UploadQueue::Job &job, bool wait, std::function< bool() > const &out_of_time) {
+	auto &buffers = job.uploads.buffers;
+	auto &textures = job.uploads.textures;
+	while (job.item < buffers.size() + textures.size()) {
+		if (out_of_time()) return false;
+		if (job.item < buffers.size()) {
+			UploadQueue::BufferUpload &upload = buffers[job.item];
+			//(destination is bound to COPY_WRITE_BUFFER so no vertex array object's element buffer binding is disturbed)
+			if (job.done == 0) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+				glBufferData(GL_COPY_WRITE_BUFFER, upload.data.size(), nullptr, GL_STATIC_DRAW);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			}
+			if (job.done < upload.data.size()) {
+				size_t piece = std::min(upload.data.size() - job.done, StagingSize);
+				void *ptr = map_staging(GL_COPY_READ_BUFFER, piece, wait);
+				if (!ptr) return false;
+				std::memcpy(ptr, upload.data.data() + job.done, piece);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+				unmap_staging(GL_COPY_READ_BUFFER);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job.done, piece);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+				fence_staging();
+				job.done += piece;
+			}
+			if (job.done == upload.data.size()) {
+				std::vector< uint8_t >().swap(upload.data);
+				job.item += 1;
+				job.done = 0;
+			}
+		} else {
+			UploadQueue::TextureUpload &upload = textures[job.item - buffers.size()];
+			if (upload.data.size() != size_t(upload.size.x) * size_t(upload.size.y)) {
+				throw std::runtime_error("Texture upload data doesn't match its size.");
+			}
+			if (job.done == 0) {
+				glBindTexture(GL_TEXTURE_2D, upload.tex);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, upload.size.x, upload.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				if (upload.size.x == 0) job.done = upload.size.y; //(no rows to copy)
+			}
+			if (job.done < upload.size.y) {
+				//copy whole rows at a time:
+				size_t row_bytes = size_t(upload.size.x) * sizeof(glm::u8vec4);
+				size_t rows = std::max< size_t >(1, StagingSize / row_bytes);
+				rows = std::min< size_t >(rows, upload.size.y - job.done);
+				void *ptr = map_staging(GL_PIXEL_UNPACK_BUFFER, rows * row_bytes, wait);
+				if (!ptr) return false;
+				std::memcpy(ptr, upload.data.data() + job.done * upload.size.x, rows * row_bytes);
+				glBindTexture(GL_TEXTURE_2D, upload.tex);
+				unmap_staging(GL_PIXEL_UNPACK_BUFFER);
+				//with a PIXEL_UNPACK_BUFFER bound, the data pointer is an offset into it:
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(job.done), upload.size.x, GLsizei(rows), GL_RGBA, GL_UNSIGNED_BYTE, (GLbyte *)0);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				fence_staging();
+				job.done += rows;
+			}
+			if (job.done == upload.size.y) {
+				std::vector< glm::u8vec4 >().swap(upload.data);
+				job.item += 1;
+				job.done = 0;
+			}
+		}
+	}
+	return true;
+}
+
+//upload directly (used when the queue isn't running):
+void upload_now(UploadQueue::Uploads const &uploads) {
+	for (auto const &upload : uploads.buffers) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, upload.data.size(), upload.data.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	for (auto const &upload : uploads.textures) {
+		glBindTexture(GL_TEXTURE_2D, upload.tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, upload.size.x, upload.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, upload.data.data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	GL_ERRORS();
+}
+
+} //unnamed namespace
+
+void UploadQueue::init(uint32_t count) {
+	assert(!running);
+	if (count == 0) {
+		count = std::max(2U, std::thread::hardware_concurrency()) - 1;
+	}
+	stopping = false;
+	for (uint32_t i = 0; i < count; ++i) {
+		workers.emplace_back(worker);
+	}
+	running = true;
+}
+
+void UploadQueue::shutdown() {
+	if (!running) return;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		stopping = true;
+		//jobs that never started are abandoned (so anything waiting on them doesn't wait forever):
+		for (auto &job : to_load) {
+			job->error = std::make_exception_ptr(std::runtime_error("UploadQueue shut down before job was loaded."));
+			job->load = nullptr;
+			job->loaded = true;
+		}
+		to_load.clear();
+	}
+	work_cv.notify_all();
+	loaded_cv.notify_all();
+	for (auto &thread : workers) {
+		thread.join();
+	}
+	workers.clear();
+
+	for (auto &job : in_flight) {
+		glDeleteSync(job->fence);
+		job->fence = 0;
+		job->uploaded = true;
+	}
+	in_flight.clear();
+	for (auto &job : to_upload) {
+		job->uploads = Uploads();
+		job->uploaded = true;
+	}
+	to_upload.clear();
+	for (auto &s : staging) {
+		if (s.fence) glDeleteSync(s.fence);
+		if (s.buffer) glDeleteBuffers(1, &s.buffer);
+		s = Staging();
+	}
+	GL_ERRORS();
+
+	running = false;
+}
+
+Ticket UploadQueue::submit(std::function< void(Uploads *) > const &load) {
+	Ticket job = std::make_shared< Job >();
+	if (!running) {
+		load(&job->uploads);
+		upload_now(job->uploads);
+		job->uploads = Uploads();
+		job->loaded = true;
+		job->uploaded = true;
+		return job;
+	}
+
+	job->load = load;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		to_load.emplace_back(job);
+	}
+	work_cv.notify_one();
+	to_upload.emplace_back(job);
+	return job;
+}
+
+void UploadQueue::wait_loaded(Ticket const &job) {
+	assert(job);
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		loaded_cv.wait(lock, [&job](){ return job->loaded; });
+	}
+	if (job->error && !job->error_reported) {
+		job->error_reported = true;
+		std::rethrow_exception(job->error);
+	}
+}
+
+void UploadQueue::wait_uploaded(Ticket const &job) {
+	assert(job);
+	wait_loaded(job);
+	while (!job->uploaded) {
+		pump(-1.0);
+	}
+}
+
+bool UploadQueue::is_uploaded(Ticket const &job) {
+	assert(job);
+	return job->uploaded;
+}
+
+void UploadQueue::pump(double budget_ms) {
+	if (!running) return;
+
+	//a negative budget means "finish everything":
+	bool wait = (budget_ms < 0.0);
+	Clock::time_point start = Clock::now();
+	auto out_of_time = [&]() -> bool {
+		return !wait && std::chrono::duration< double, std::milli >(Clock::now() - start).count() >= budget_ms;
+	};
+
+	//retire jobs whose copies have finished (fences signal in order):
+	auto retire = [&](bool wait_for_fence) {
+		while (!in_flight.empty() && fence_signalled(in_flight.front()->fence, wait_for_fence)) {
+			Ticket job = in_flight.front();
+			in_flight.pop_front();
+			glDeleteSync(job->fence);
+			job->fence = 0;
+			job->uploads = Uploads();
+			job->uploaded = true;
+		}
+	};
+	retire(false);
+
+	while (!to_upload.empty() && !out_of_time()) {
+		//copy the first job that is ready (or, if waiting, the oldest job):
+		auto j = to_upload.begin();
+		if (!wait) {
+			while (j != to_upload.end() && !is_loaded(*j)) ++j;
+			if (j == to_upload.end()) break;
+		}
+		Ticket job = *j;
+		if (wait) {
+			std::unique_lock< std::mutex > lock(mutex);
+			loaded_cv.wait(lock, [&job](){ return job->loaded; });
+		}
+
+		if (job->error) {
+			to_upload.erase(j);
+			job->uploads = Uploads();
+			job->uploaded = true;
+			if (!job->error_reported) {
+				job->error_reported = true;
+				std::rethrow_exception(job->error);
+			}
+			continue;
+		}
+
+		if (!issue(*job, wait, out_of_time)) break;
+		to_upload.erase(j);
+		job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		in_flight.emplace_back(job);
+	}
+
+	retire(wait);
+	GL_ERRORS();
+}
+
+bool UploadQueue::busy() {
+	return !to_upload.empty() || !in_flight.empty();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+//Streams resources to the GPU without stalling the GL thread:
+// - submit()'d load functions (file reading, decoding) run on worker threads;
+// - the buffer and texture data they produce is copied into staging buffers and
+//   from there into the destination GL objects by pump(), which runs on the GL thread,
+//   does a bounded amount of work per call, and tracks completion with fences.
+//When the queue isn't running (init() not called -- e.g., in tools), submit() loads and uploads immediately.
+
+namespace UploadQueue {
+
+//data for a buffer object (of any kind); its storage is (re)allocated with GL_STATIC_DRAW usage:
+struct BufferUpload {
+	GLuint buffer = 0;
+	std::vector< uint8_t > data;
+};
+
+//data for level 0 of a GL_RGBA8 2D texture (rows in GL order):
+struct TextureUpload {
+	GLuint tex = 0;
+	glm::uvec2 size = glm::uvec2(0);
+	std::vector< glm::u8vec4 > data;
+};
+
+//everything a load function wants copied to the GPU:
+struct Uploads {
+	std::vector< BufferUpload > buffers;
+	std::vector< TextureUpload > textures;
+};
+
+struct Job;
+typedef std::shared_ptr< Job > Ticket;
+
+//start worker threads (0 == one fewer than the number of hardware threads, but at least one):
+void init(uint32_t workers = 0);
+//stop worker threads (after waiting for running load functions) and release staging buffers; call before destroying the GL context:
+void shutdown();
+
+//run 'load' on a worker thread; it may throw, in which case the exception is rethrown by wait_loaded() or pump():
+// note: 'load' must not call OpenGL functions.
+Ticket submit(std::function< void(Uploads *) > const &load);
+
+//block until the ticket's load function has finished (rethrows its exception, if any):
+void wait_loaded(Ticket const &ticket);
+//pump (without a time limit) until the ticket's data is on the GPU; call from the GL thread:
+void wait_uploaded(Ticket const &ticket);
+bool is_uploaded(Ticket const &ticket);
+
+//copy loaded data toward the GPU for about 'budget_ms' milliseconds; call from the GL thread once per frame:
+void pump(double budget_ms);
+//are any submitted jobs not yet uploaded?
+bool busy();
+
+} //namespace UploadQueue
@@ -0,0 +1,251 @@
+#include "RollMode.hpp"
+#include "RollLevel.hpp"
+#include "Load.hpp"
+#include "GL.hpp"
+#include "UploadQueue.hpp"
+#include "Parallel.hpp"
+#include "data_path.hpp"
+
+#include <SDL.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmark Sphere Roll physics on the shipped levels:
+ *  - loads roll-level-1..3 exactly as the game does (so it needs an OpenGL context, made with a hidden window;
+ *    on machines without a display, SDL_VIDEODRIVER=offscreen may work)
+ *  - drives the sphere with scripted controls at a fixed timestep, never drawing
+ *  - reports update() rate and the collide-and-slide work per frame (see RollMode::Stats)
+ */
+
+//fixed timestep (matches a 60Hz display):
+constexpr float Timestep = 1.0f / 60.0f;
+
+//controls held for a while:
+struct Step {
+	float seconds;
+	bool forward, backward, left, right;
+	float turn; //view azimuth change, in radians/second
+};
+
+struct Script {
+	char const *name;
+	std::vector< Step > steps; //repeated until the run is over
+};
+
+static std::vector< Script > const scripts = {
+	//resting on the floor (the cheapest case, as long as candidates are reused):
+	{ "idle", {
+		{ 1.0f, false, false, false, false, 0.0f },
+	}},
+	//rolling straight ahead, probably off an edge:
+	{ "forward", {
+		{ 1.0f, true, false, false, false, 0.0f },
+	}},
+	//weaving back and forth:
+	{ "zigzag", {
+		{ 0.75f, true, false, true, false, 0.0f },
+		{ 0.75f, true, false, false, true, 0.0f },
+	}},
+	//rolling in circles:
+	{ "circles", {
+		{ 1.0f, true, false, false, false, 1.5f },
+	}},
+	//a bit of everything, like someone exploring:
+	{ "wander", {
+		{ 2.0f, true, false, false, false, 0.0f },
+		{ 1.0f, false, false, false, true, 0.5f },
+		{ 1.5f, false, true, false, false, 0.0f },
+		{ 1.0f, false, false, true, false, -0.5f },
+		{ 1.0f, true, false, false, true, 0.0f },
+		{ 0.5f, false, false, false, false, 0.0f },
+	}},
+};
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try { //windows doesn't print nice errors for unhandled exceptions, so we need to.
+#endif
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t./bench-roll [seconds [dist-dir]]\n";
+		std::cerr << " will run each scripted input sequence for 'seconds' (default: 20) of game time on each Sphere Roll level.\n";
+		std::cerr << " levels and meshes are read from 'dist-dir' (default: the 'dist' directory next to bench-roll).\n";
+		std::cerr.flush();
+		return 1;
+	}
+	float seconds = 20.0f;
+	if (argc >= 2) {
+		seconds = std::stof(argv[1]);
+		if (!(seconds > 0.0f)) throw std::runtime_error("Run length must be positive.");
+	}
+	//(the game's data lives in 'dist', and bench-roll doesn't)
+	set_data_path(argc >= 3 ? std::string(argv[2]) : data_path("dist"));
+	uint32_t frames = uint32_t(std::ceil(seconds / Timestep));
+
+	//------------  initialization ------------
+
+	SDL_Init(SDL_INIT_VIDEO);
+
+	//levels upload meshes and compile programs, so an OpenGL 3.3 context is needed (even though nothing is drawn):
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	SDL_Window *window = SDL_CreateWindow(
+		"bench-roll",
+		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		64, 64,
+		SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN
+	);
+	if (!window) {
+		std::cerr << "Error creating SDL window: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+	if (!context) {
+		SDL_DestroyWindow(window);
+		std::cerr << "Error creating OpenGL context: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+
+	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
+	init_GL();
+
+	//(same worker threads as the game, so parallel sweeps are measured as played)
+	Parallel::init();
+
+	UploadQueue::init();
+	call_load_functions();
+	while (UploadQueue::busy()) {
+		UploadQueue::pump(100.0);
+	}
+
+	//------------ benchmark ------------
+
+	std::cout << "Sphere Roll physics (" << frames << " frames of " << Timestep * 1000.0f << "ms per run):\n";
+	std::cout << "  " << std::left << std::setw(24) << "level / script" << std::right
+		<< std::setw(12) << "frames/sec"
+		<< std::setw(12) << "steps/frame"
+		<< std::setw(12) << "iters/frame"
+		<< std::setw(12) << "tris/frame"
+		<< std::setw(12) << "boxes/frame"
+		<< std::setw(12) << "us/iter"
+		<< std::setw(10) << "gathers"
+		<< std::setw(12) << "over budget"
+		<< std::setw(10) << "falls"
+		<< "\n";
+	std::cout << std::fixed;
+
+	RollMode::Stats total;
+	double total_seconds = 0.0;
+	uint32_t total_falls = 0;
+	uint32_t level_index = 0;
+	for (RollLevel const &level : *roll_levels) {
+		level_index += 1;
+		for (Script const &script : scripts) {
+			RollMode mode(level);
+			mode.stats = RollMode::Stats();
+			mode.stats.timing = true;
+
+			uint32_t falls = 0;
+			uint32_t step = 0;
+			float step_remain = script.steps[0].seconds;
+
+			auto before = std::chrono::high_resolution_clock::now();
+			for (uint32_t frame = 0; frame < frames; ++frame) {
+				while (step_remain <= 0.0f) {
+					step = (step + 1) % script.steps.size();
+					step_remain += script.steps[step].seconds;
+				}
+				Step const &s = script.steps[step];
+				step_remain -= Timestep;
+
+				mode.controls.forward = s.forward;
+				mode.controls.backward = s.backward;
+				mode.controls.left = s.left;
+				mode.controls.right = s.right;
+				mode.level.player.view_azimuth += s.turn * Timestep;
+
+				mode.update(Timestep);
+
+				//fell off the level; start over (as a player would):
+				if (mode.level.player.transform->position.z < -20.0f) {
+					falls += 1;
+					float azimuth = mode.level.player.view_azimuth;
+					mode.restart();
+					mode.level.player.view_azimuth = azimuth;
+				}
+			}
+			double elapsed = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - before).count();
+
+			RollMode::Stats const &stats = mode.stats;
+			std::string name = "roll-level-" + std::to_string(level_index) + " / " + script.name;
+			std::cout << "  " << std::left << std::setw(24) << name << std::right
+				<< std::setprecision(0) << std::setw(12) << stats.frames / elapsed
+				<< std::setprecision(2) << std::setw(12) << double(stats.substeps) / stats.frames
+				<< std::setprecision(2) << std::setw(12) << double(stats.iterations) / stats.frames
+				<< std::setprecision(1) << std::setw(12) << double(stats.triangle_tests) / stats.frames
+				<< std::setprecision(1) << std::setw(12) << double(stats.box_tests) / stats.frames
+				<< std::setprecision(3) << std::setw(12) << (stats.iterations ? stats.sweep_seconds / stats.iterations * 1e6 : 0.0)
+				<< std::setw(10) << stats.gathers
+				<< std::setw(12) << stats.over_budget
+				<< std::setw(10) << falls
+				<< "\n";
+
+			total.frames += stats.frames;
+			total.substeps += stats.substeps;
+			total.iterations += stats.iterations;
+			total.over_budget += stats.over_budget;
+			total.triangle_tests += stats.triangle_tests;
+			total.box_tests += stats.box_tests;
+			total.gathers += stats.gathers;
+			total.gather_seconds += stats.gather_seconds;
+			total.sweep_seconds += stats.sweep_seconds;
+			total_seconds += elapsed;
+			total_falls += falls;
+		}
+	}
+
+	std::cout << "  " << std::left << std::setw(24) << "(all)" << std::right
+		<< std::setprecision(0) << std::setw(12) << total.frames / total_seconds
+		<< std::setprecision(2) << std::setw(12) << double(total.substeps) / total.frames
+		<< std::setprecision(2) << std::setw(12) << double(total.iterations) / total.frames
+		<< std::setprecision(1) << std::setw(12) << double(total.triangle_tests) / total.frames
+		<< std::setprecision(1) << std::setw(12) << double(total.box_tests) / total.frames
+		<< std::setprecision(3) << std::setw(12) << (total.iterations ? total.sweep_seconds / total.iterations * 1e6 : 0.0)
+		<< std::setw(10) << total.gathers
+		<< std::setw(12) << total.over_budget
+		<< std::setw(10) << total_falls
+		<< "\n";
+	std::cout << "  time in update(): " << std::setprecision(1) << total_seconds * 1000.0 << "ms"
+		<< " (sweeps " << total.sweep_seconds * 1000.0 << "ms, gathers " << total.gather_seconds * 1000.0 << "ms)" << std::endl;
+	std::cout << std::defaultfloat;
+
+	//------------  teardown ------------
+
+	UploadQueue::shutdown();
+	Parallel::shutdown();
+
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
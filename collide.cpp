@@ -1,8 +1,24 @@
 #include "collide.hpp"
 
+#include "Parallel.hpp"
+
 #include <initializer_list>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <tuple>
+
+//the batched functions use SSE2 where it's always available:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLIDE_SSE2 1
+#include <emmintrin.h>
+#else
+#define COLLIDE_SSE2 0
+#endif
 
 
 //Check if two AABBs overlap:
@@ -85,6 +101,10 @@ bool collide_ray_vs_cylinder(glm::vec3 ray_start, glm::vec3 ray_direction,
 		float *collision_t, glm::vec3 *collision_at, glm::vec3 *collision_out
 ) {
 
+	//(hits later than *collision_t don't count, so a later edge can't replace an earlier hit)
+	float t_limit = 1.0f;
+	if (collision_t) t_limit = std::min(t_limit, *collision_t);
+
 	glm::vec3 cy_axis = cylinder_b - cylinder_a;
 
 	float cy_height = glm::dot(cy_axis, cy_axis);
@@ -123,6 +143,7 @@ bool collide_ray_vs_cylinder(glm::vec3 ray_start, glm::vec3 ray_direction,
 		&t, nullptr, nullptr
   )) {
     t += t0;
+    if (!(t <= t_limit)) return false;
     glm::vec3 out = careful_normalize(ray_start - projected_pt + t * (ray_direction - projected_dir));
 		if (collision_t) *collision_t = t;
 		if (collision_out) *collision_out = out;
@@ -138,21 +159,21 @@ bool collide_swept_sphere_vs_swept_sphere(
 	glm::vec3 const &sphere1_from, glm::vec3 const &sphere1_to, float sphere1_radius,
 	float *collision_t, glm::vec3 *collision_at, glm::vec3 *collision_out
 ) {
+	//sweep sphere0 relative to sphere1, as a ray vs a sphere with the sum of the radii:
 	glm::vec3 sphere1_dir = sphere1_to - sphere1_from;
-	glm::vec3 dir_sum = sphere0_to - sphere0_from - sphere1_dir;
-	float t;
-	glm::vec3 at;
-	bool collided = collide_ray_vs_sphere(sphere0_from, sphere0_from + dir_sum, sphere1_from, sphere0_radius + sphere1_radius, &t, &at, collision_out);
+	glm::vec3 relative_dir = (sphere0_to - sphere0_from) - sphere1_dir;
+	float t = 1.0f;
+	if (collision_t) t = std::min(t, *collision_t);
+	glm::vec3 out;
+	bool collided = collide_ray_vs_sphere(sphere0_from, relative_dir, sphere1_from, sphere0_radius + sphere1_radius, &t, nullptr, &out);
 	if (collided) {
 		if (collision_t) *collision_t = t;
-		if (collision_at) {
-			at += t * sphere1_dir;
-			*collision_at = at;
-		}
+		if (collision_at) *collision_at = glm::mix(sphere0_from, sphere0_to, t) - sphere0_radius * out;
+		if (collision_out) *collision_out = out;
 	}
 	return collided;
-
 }
+
 bool collide_swept_sphere_vs_triangle(
 	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
 	glm::vec3 const &triangle_a, glm::vec3 const &triangle_b, glm::vec3 const &triangle_c,
@@ -177,7 +198,7 @@ bool collide_swept_sphere_vs_triangle(
 		t0 = (dot_from - sphere_radius) / (dot_from - dot_to);
 		t1 = (dot_from + sphere_radius) / (dot_from - dot_to);
 	} else if (dot_from < 0.0f && dot_from < dot_to){
-		t0 = (dot_from + sphere_radius) / (dot_to - dot_from);
+		t0 = (- dot_from - sphere_radius) / (dot_to - dot_from);
 		t1 = (- dot_from + sphere_radius) / (dot_to - dot_from);
 	}
 
@@ -245,3 +266,662 @@ bool collide_swept_sphere_vs_triangle(
 
 	//-----------------------------
 }
+
+//------------------------------------------------
+//Precomputed triangles:
+
+CollisionTriangle make_collision_triangle(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	CollisionTriangle triangle;
+	triangle.a = a;
+	triangle.b = b;
+	triangle.c = c;
+	//(degenerate triangles end up with NaN planes, which never collide)
+	triangle.normal = glm::normalize(glm::cross(b-a, c-a));
+	triangle.offset = glm::dot(triangle.normal, a);
+	glm::vec3 const *corners[3] = {&triangle.a, &triangle.b, &triangle.c};
+	for (uint32_t e = 0; e < 3; ++e) {
+		glm::vec3 const &from = *corners[e];
+		glm::vec3 const &to = *corners[(e + 1) % 3];
+		glm::vec3 inward = glm::normalize(glm::cross(triangle.normal, to - from));
+		triangle.edge_planes[e] = glm::vec4(inward, glm::dot(inward, from));
+	}
+	triangle.features = CollisionTriangle::AllFeatures;
+	return triangle;
+}
+
+void mark_convex_features(std::vector< CollisionTriangle > *triangles_, float welding_distance) {
+	assert(triangles_);
+	auto &triangles = *triangles_;
+
+	//weld corners by rounding them to a grid:
+	std::map< std::tuple< int64_t, int64_t, int64_t >, uint32_t > welded;
+	auto weld = [&](glm::vec3 const &p) {
+		glm::vec3 cell = glm::floor(p / welding_distance + 0.5f);
+		auto key = std::make_tuple(int64_t(cell.x), int64_t(cell.y), int64_t(cell.z));
+		return welded.emplace(key, uint32_t(welded.size())).first->second;
+	};
+
+	//edge uses (triangle * 3 + edge), by (unordered) welded endpoints:
+	std::map< std::pair< uint32_t, uint32_t >, std::vector< uint32_t > > edge_uses;
+	std::vector< uint32_t > corner_ids(triangles.size() * 3);
+	for (uint32_t t = 0; t < triangles.size(); ++t) {
+		corner_ids[3*t+0] = weld(triangles[t].a);
+		corner_ids[3*t+1] = weld(triangles[t].b);
+		corner_ids[3*t+2] = weld(triangles[t].c);
+		for (uint32_t e = 0; e < 3; ++e) {
+			uint32_t from = corner_ids[3*t+e];
+			uint32_t to = corner_ids[3*t+(e+1)%3];
+			if (from == to) continue; //(degenerate)
+			edge_uses[std::make_pair(std::min(from, to), std::max(from, to))].emplace_back(3*t+e);
+		}
+	}
+
+	auto corner = [&](uint32_t t, uint32_t i) -> glm::vec3 const & {
+		return (i == 0 ? triangles[t].a : (i == 1 ? triangles[t].b : triangles[t].c));
+	};
+
+	for (auto const &edge_use : edge_uses) {
+		std::vector< uint32_t > const &uses = edge_use.second;
+		if (uses.size() != 2) continue; //boundary or non-manifold edges stay
+		uint32_t t0 = uses[0] / 3, e0 = uses[0] % 3;
+		uint32_t t1 = uses[1] / 3, e1 = uses[1] % 3;
+		//neighbors must run along the edge in opposite directions (consistent winding):
+		if (corner_ids[3*t0+e0] != corner_ids[3*t1+(e1+1)%3]) continue;
+		CollisionTriangle &tri0 = triangles[t0];
+		CollisionTriangle &tri1 = triangles[t1];
+		//edge is convex if each triangle's far corner is below the other's plane:
+		float below0 = glm::dot(tri0.normal, corner(t1, (e1+2)%3)) - tri0.offset;
+		float below1 = glm::dot(tri1.normal, corner(t0, (e0+2)%3)) - tri1.offset;
+		if (!(below0 >= -welding_distance && below1 >= -welding_distance)) continue; //(also keeps degenerate/NaN cases)
+		//flat or concave, so the sphere will always touch a face first:
+		tri0.features &= ~(1U << e0);
+		tri1.features &= ~(1U << e1);
+		//...and let the faces overlap slightly along it, so nothing slips through the seam:
+		tri0.edge_planes[e0].w -= welding_distance;
+		tri1.edge_planes[e1].w -= welding_distance;
+	}
+
+	//vertices only need testing where they are the end of a convex edge:
+	// (edges around a vertex shared by other triangles are checked by those triangles)
+	for (auto &triangle : triangles) {
+		uint32_t edges = triangle.features;
+		triangle.features &= ~uint32_t(CollisionTriangle::VertexA | CollisionTriangle::VertexB | CollisionTriangle::VertexC);
+		if (edges & (CollisionTriangle::EdgeCA | CollisionTriangle::EdgeAB)) triangle.features |= CollisionTriangle::VertexA;
+		if (edges & (CollisionTriangle::EdgeAB | CollisionTriangle::EdgeBC)) triangle.features |= CollisionTriangle::VertexB;
+		if (edges & (CollisionTriangle::EdgeBC | CollisionTriangle::EdgeCA)) triangle.features |= CollisionTriangle::VertexC;
+	}
+}
+
+//------------------------------------------------
+//Batched swept sphere vs triangles:
+
+void PackedTriangles::clear() {
+	blocks.clear();
+	count = 0;
+}
+
+void PackedTriangles::push_back(CollisionTriangle const &triangle) {
+	if (count % 4 == 0) {
+		//new blocks start out as degenerate (zero-area, no features) triangles, which never collide:
+		blocks.emplace_back();
+		std::memset(&blocks.back(), 0, sizeof(Block));
+	}
+	Block &block = blocks.back();
+	uint32_t i = count % 4;
+	block.ax[i] = triangle.a.x; block.ay[i] = triangle.a.y; block.az[i] = triangle.a.z;
+	block.bx[i] = triangle.b.x; block.by[i] = triangle.b.y; block.bz[i] = triangle.b.z;
+	block.cx[i] = triangle.c.x; block.cy[i] = triangle.c.y; block.cz[i] = triangle.c.z;
+	block.nx[i] = triangle.normal.x; block.ny[i] = triangle.normal.y; block.nz[i] = triangle.normal.z;
+	block.offset[i] = triangle.offset;
+	for (uint32_t e = 0; e < 3; ++e) {
+		block.ex[e][i] = triangle.edge_planes[e].x;
+		block.ey[e][i] = triangle.edge_planes[e].y;
+		block.ez[e][i] = triangle.edge_planes[e].z;
+		block.eoffset[e][i] = triangle.edge_planes[e].w;
+	}
+	block.features[i] = triangle.features;
+	count += 1;
+}
+
+void PackedTriangles::push_back(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	push_back(make_collision_triangle(a, b, c));
+}
+
+glm::vec3 PackedTriangles::a(uint32_t i) const {
+	assert(i < count);
+	Block const &block = blocks[i / 4];
+	return glm::vec3(block.ax[i % 4], block.ay[i % 4], block.az[i % 4]);
+}
+glm::vec3 PackedTriangles::b(uint32_t i) const {
+	assert(i < count);
+	Block const &block = blocks[i / 4];
+	return glm::vec3(block.bx[i % 4], block.by[i % 4], block.bz[i % 4]);
+}
+glm::vec3 PackedTriangles::c(uint32_t i) const {
+	assert(i < count);
+	Block const &block = blocks[i / 4];
+	return glm::vec3(block.cx[i % 4], block.cy[i % 4], block.cz[i % 4]);
+}
+
+namespace {
+
+//Four-wide float math (SSE2 where available, otherwise plain loops):
+#if COLLIDE_SSE2
+struct F4 { __m128 v; };
+struct M4 { __m128 v; }; //lane masks
+
+inline F4 splat(float x) { return F4{_mm_set1_ps(x)}; }
+inline F4 load(float const *p) { return F4{_mm_loadu_ps(p)}; }
+inline void store(F4 a, float *p) { _mm_storeu_ps(p, a.v); }
+inline F4 operator+(F4 a, F4 b) { return F4{_mm_add_ps(a.v, b.v)}; }
+inline F4 operator-(F4 a, F4 b) { return F4{_mm_sub_ps(a.v, b.v)}; }
+inline F4 operator*(F4 a, F4 b) { return F4{_mm_mul_ps(a.v, b.v)}; }
+inline F4 operator/(F4 a, F4 b) { return F4{_mm_div_ps(a.v, b.v)}; }
+inline F4 min(F4 a, F4 b) { return F4{_mm_min_ps(a.v, b.v)}; }
+inline F4 max(F4 a, F4 b) { return F4{_mm_max_ps(a.v, b.v)}; }
+inline F4 sqrt(F4 a) { return F4{_mm_sqrt_ps(a.v)}; }
+inline M4 operator<(F4 a, F4 b) { return M4{_mm_cmplt_ps(a.v, b.v)}; }
+inline M4 operator<=(F4 a, F4 b) { return M4{_mm_cmple_ps(a.v, b.v)}; }
+inline M4 operator>(F4 a, F4 b) { return M4{_mm_cmpgt_ps(a.v, b.v)}; }
+inline M4 operator>=(F4 a, F4 b) { return M4{_mm_cmpge_ps(a.v, b.v)}; }
+inline M4 operator&(M4 a, M4 b) { return M4{_mm_and_ps(a.v, b.v)}; }
+inline M4 operator|(M4 a, M4 b) { return M4{_mm_or_ps(a.v, b.v)}; }
+inline M4 and_not(M4 a, M4 b) { return M4{_mm_andnot_ps(b.v, a.v)}; } //a & !b
+inline F4 select(M4 m, F4 a, F4 b) { return F4{_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))}; }
+inline uint32_t bits(M4 m) { return uint32_t(_mm_movemask_ps(m.v)); }
+inline M4 first_lanes(uint32_t n) { //lanes [0,n)
+	return M4{_mm_castsi128_ps(_mm_cmplt_epi32(_mm_set_epi32(3, 2, 1, 0), _mm_set1_epi32(int32_t(n))))};
+}
+inline M4 has_bits(uint32_t const *flags, uint32_t mask) { //lanes where (flags[i] & mask) != 0
+	__m128i masked = _mm_and_si128(_mm_loadu_si128(reinterpret_cast< __m128i const * >(flags)), _mm_set1_epi32(int32_t(mask)));
+	return M4{_mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(masked, _mm_setzero_si128()), _mm_set1_epi32(-1)))};
+}
+#else
+struct F4 { float v[4]; };
+struct M4 { bool v[4]; };
+
+inline F4 splat(float x) { return F4{{x, x, x, x}}; }
+inline F4 load(float const *p) { return F4{{p[0], p[1], p[2], p[3]}}; }
+inline void store(F4 a, float *p) { for (uint32_t i = 0; i < 4; ++i) p[i] = a.v[i]; }
+#define LANEWISE(EXPR) for (uint32_t i = 0; i < 4; ++i) { r.v[i] = (EXPR); } return r
+inline F4 operator+(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] + b.v[i]); }
+inline F4 operator-(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] - b.v[i]); }
+inline F4 operator*(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] * b.v[i]); }
+inline F4 operator/(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] / b.v[i]); }
+//(same NaN behavior as the SSE instructions: return b unless a < b / a > b)
+inline F4 min(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+inline F4 max(F4 a, F4 b) { F4 r; LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+inline F4 sqrt(F4 a) { F4 r; LANEWISE(std::sqrt(a.v[i])); }
+inline M4 operator<(F4 a, F4 b) { M4 r; LANEWISE(a.v[i] < b.v[i]); }
+inline M4 operator<=(F4 a, F4 b) { M4 r; LANEWISE(a.v[i] <= b.v[i]); }
+inline M4 operator>(F4 a, F4 b) { M4 r; LANEWISE(a.v[i] > b.v[i]); }
+inline M4 operator>=(F4 a, F4 b) { M4 r; LANEWISE(a.v[i] >= b.v[i]); }
+inline M4 operator&(M4 a, M4 b) { M4 r; LANEWISE(a.v[i] && b.v[i]); }
+inline M4 operator|(M4 a, M4 b) { M4 r; LANEWISE(a.v[i] || b.v[i]); }
+inline M4 and_not(M4 a, M4 b) { M4 r; LANEWISE(a.v[i] && !b.v[i]); }
+inline F4 select(M4 m, F4 a, F4 b) { F4 r; LANEWISE(m.v[i] ? a.v[i] : b.v[i]); }
+inline M4 first_lanes(uint32_t n) { M4 r; LANEWISE(i < n); }
+inline M4 has_bits(uint32_t const *flags, uint32_t mask) { M4 r; LANEWISE((flags[i] & mask) != 0); }
+#undef LANEWISE
+inline uint32_t bits(M4 m) { return (m.v[0] ? 1U : 0U) | (m.v[1] ? 2U : 0U) | (m.v[2] ? 4U : 0U) | (m.v[3] ? 8U : 0U); }
+#endif
+
+struct V4 { F4 x, y, z; };
+inline V4 operator+(V4 const &a, V4 const &b) { return V4{a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline V4 operator-(V4 const &a, V4 const &b) { return V4{a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline V4 operator*(F4 s, V4 const &a) { return V4{s * a.x, s * a.y, s * a.z}; }
+inline V4 operator/(V4 const &a, F4 s) { return V4{a.x / s, a.y / s, a.z / s}; }
+inline F4 dot(V4 const &a, V4 const &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline V4 cross(V4 const &a, V4 const &b) {
+	return V4{a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y};
+}
+inline V4 splat(glm::vec3 const &v) { return V4{splat(v.x), splat(v.y), splat(v.z)}; }
+
+//the parts of a triangle's surface, in the order collide_swept_sphere_vs_triangle tests them:
+// (edge/vertex feature f is CollisionTriangle flag 1 << (f - 1))
+enum Feature : uint32_t {
+	Face = 0,
+	EdgeAB = 1, EdgeBC = 2, EdgeCA = 3,
+	VertexA = 4, VertexB = 5, VertexC = 6,
+};
+
+//lanes of collide_ray_vs_sphere (from sphere_from along dir, vs sphere of radius at center):
+// hits where 'ok'; t is the (clamped) hit time.
+inline void ray_vs_sphere4(V4 const &start_to_center, V4 const &dir, F4 radius, F4 limit, M4 *ok, F4 *t) {
+	F4 zero = splat(0.0f);
+	F4 a = dot(dir, dir);
+	F4 b = splat(2.0f) * dot(start_to_center, dir);
+	F4 c = dot(start_to_center, start_to_center) - radius * radius;
+	F4 d = b * b - splat(4.0f) * a * c;
+	F4 root = sqrt(max(d, zero));
+	F4 t0 = (zero - b - root) / (splat(2.0f) * a);
+	F4 t1 = (zero - b + root) / (splat(2.0f) * a);
+	*ok = and_not(and_not(limit > zero, d < zero), (t1 < zero) | (t0 > limit));
+	*t = max(t0, zero);
+}
+
+//lanes of collide_ray_vs_cylinder (from sphere_from along dir, vs cylinder from a to b):
+inline void ray_vs_cylinder4(V4 const &from, V4 const &dir, V4 const &a, V4 const &b, F4 radius, F4 limit, M4 *ok, F4 *t) {
+	F4 zero = splat(0.0f);
+	F4 one = splat(1.0f);
+	V4 axis = b - a;
+	F4 height = dot(axis, axis);
+	F4 dot_from = dot(from - a, axis);
+	F4 dot_to = dot((from + dir) - a, axis);
+	F4 dot_delta = dot_to - dot_from;
+
+	M4 miss = ((dot_from < zero) & (dot_to <= dot_from))
+		| ((dot_from > height) & (dot_to >= dot_from))
+		| ((dot_to < zero) & (dot_from <= dot_to))
+		| ((dot_to > height) & (dot_from >= dot_to));
+
+	F4 t0 = select(dot_from < zero, (zero - dot_from) / dot_delta, zero);
+	t0 = select(dot_from > height, (height - dot_from) / dot_delta, t0);
+	F4 t1 = select(dot_to < zero, (zero - dot_from) / dot_delta, one);
+	t1 = select(dot_to > height, (height - dot_from) / dot_delta, t1);
+
+	V4 projected_pt = a + (V4{dot_from * axis.x, dot_from * axis.y, dot_from * axis.z} / height);
+	V4 projected_dir = V4{dot_delta * axis.x, dot_delta * axis.y, dot_delta * axis.z} / height;
+	V4 rel_dir = dir - projected_dir;
+	V4 rel_start = (from - projected_pt) + t0 * rel_dir;
+
+	M4 hit;
+	F4 hit_t;
+	ray_vs_sphere4(rel_start, rel_dir, radius, min(one, t1 - t0), &hit, &hit_t);
+	hit_t = hit_t + t0;
+	*ok = and_not(hit, miss) & (hit_t <= limit);
+	*t = hit_t;
+}
+
+//earliest contact with the triangles in blocks [block_begin, block_end), as in collide_swept_sphere_vs_triangles:
+// *best_t is the (in+out) time limit; returns the triangle's index (or -1U) and sets *best_feature_ to the feature touched.
+uint32_t first_contact(
+	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
+	PackedTriangles const &triangles, uint32_t block_begin, uint32_t block_end,
+	float *best_t_, uint32_t *best_feature_
+) {
+	float best_t = *best_t_;
+	uint32_t best = -1U;
+	uint32_t best_feature = Face;
+
+	V4 from = splat(sphere_from);
+	V4 to = splat(sphere_to);
+	V4 dir = splat(sphere_to - sphere_from);
+	F4 radius = splat(sphere_radius);
+	F4 zero = splat(0.0f);
+	F4 one = splat(1.0f);
+
+	for (uint32_t block_index = block_begin; block_index < block_end; ++block_index) {
+		//(nothing replaces a contact at t = 0, as when testing one at a time)
+		if (best_t <= 0.0f) break;
+		PackedTriangles::Block const &block = triangles.blocks[block_index];
+		M4 valid = first_lanes(std::min(4U, triangles.count - 4 * block_index));
+		F4 limit = splat(best_t);
+
+		V4 a{load(block.ax), load(block.ay), load(block.az)};
+		V4 b{load(block.bx), load(block.by), load(block.bz)};
+		V4 c{load(block.cx), load(block.cy), load(block.cz)};
+
+		//time interval where the sphere overlaps the triangle's plane:
+		V4 norm{load(block.nx), load(block.ny), load(block.nz)};
+		F4 offset = load(block.offset);
+		F4 dot_from = dot(norm, from) - offset;
+		F4 dot_to = dot(norm, to) - offset;
+		M4 above = (dot_from > zero) & (dot_from > dot_to);
+		M4 below = (dot_from < zero) & (dot_from < dot_to);
+		F4 t0 = select(above, (dot_from - radius) / (dot_from - dot_to), select(below, (zero - dot_from - radius) / (dot_to - dot_from), one));
+		F4 t1 = select(above, (dot_from + radius) / (dot_from - dot_to), select(below, (zero - dot_from + radius) / (dot_to - dot_from), zero - one));
+
+		M4 active = and_not(valid, (t1 < zero) | (t0 > limit));
+		if (bits(active) == 0) continue;
+
+		//where the sphere first touches the plane, is it over the triangle?
+		F4 at_t = max(zero, t0);
+		V4 at = (one - at_t) * from + at_t * to;
+		V4 triangle_pt = at + (offset - dot(norm, at)) * norm;
+		M4 inside = active;
+		for (uint32_t e = 0; e < 3; ++e) {
+			V4 edge_norm{load(block.ex[e]), load(block.ey[e]), load(block.ez[e])};
+			inside = inside & (dot(edge_norm, triangle_pt) >= load(block.eoffset[e]));
+		}
+
+		M4 hit = active & inside;
+		F4 lane_t = select(hit, at_t, limit);
+		F4 lane_feature = splat(float(Face));
+
+		//otherwise, check edges then vertices (later features replace earlier ones at the same time):
+		//(only testing edges and vertices that might be touched before a face)
+		M4 outside = and_not(active, inside);
+		if (bits(outside & has_bits(block.features, CollisionTriangle::AllFeatures))) {
+			auto update = [&](M4 feature_hit, F4 feature_t, Feature feature) {
+				feature_hit = outside & feature_hit & (feature_t <= lane_t) & has_bits(block.features, 1U << (feature - 1));
+				lane_t = select(feature_hit, feature_t, lane_t);
+				lane_feature = select(feature_hit, splat(float(feature)), lane_feature);
+				hit = hit | feature_hit;
+			};
+			M4 feature_hit;
+			F4 feature_t;
+			ray_vs_cylinder4(from, dir, a, b, radius, lane_t, &feature_hit, &feature_t);
+			update(feature_hit, feature_t, EdgeAB);
+			ray_vs_cylinder4(from, dir, b, c, radius, lane_t, &feature_hit, &feature_t);
+			update(feature_hit, feature_t, EdgeBC);
+			ray_vs_cylinder4(from, dir, c, a, radius, lane_t, &feature_hit, &feature_t);
+			update(feature_hit, feature_t, EdgeCA);
+			ray_vs_sphere4(from - a, dir, radius, min(one, lane_t), &feature_hit, &feature_t);
+			update(feature_hit, feature_t, VertexA);
+			ray_vs_sphere4(from - b, dir, radius, min(one, lane_t), &feature_hit, &feature_t);
+			update(feature_hit, feature_t, VertexB);
+			ray_vs_sphere4(from - c, dir, radius, min(one, lane_t), &feature_hit, &feature_t);
+			update(feature_hit, feature_t, VertexC);
+		}
+
+		uint32_t hit_bits = bits(hit);
+		if (hit_bits == 0) continue;
+		float lane_ts[4], lane_features[4];
+		store(lane_t, lane_ts);
+		store(lane_feature, lane_features);
+		for (uint32_t i = 0; i < 4; ++i) {
+			//(in order, so ties go to the later triangle, as when testing one at a time -- except at t = 0, which nothing replaces)
+			if (best_t <= 0.0f) break;
+			if ((hit_bits & (1U << i)) && lane_ts[i] <= best_t) {
+				best = 4 * block_index + i;
+				best_t = lane_ts[i];
+				best_feature = uint32_t(lane_features[i]);
+			}
+		}
+	}
+
+	*best_t_ = best_t;
+	*best_feature_ = best_feature;
+	return best;
+}
+
+//contact details for a sphere touching 'best_feature' of triangle 'best' at time best_t:
+void contact_details(
+	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
+	PackedTriangles const &triangles, uint32_t best, uint32_t best_feature, float best_t,
+	glm::vec3 *at_, glm::vec3 *out_
+) {
+	glm::vec3 dir1 = sphere_to - sphere_from;
+	glm::vec3 a = triangles.a(best), b = triangles.b(best), c = triangles.c(best);
+	glm::vec3 at, out;
+	if (best_feature == Face) {
+		PackedTriangles::Block const &block = triangles.blocks[best / 4];
+		glm::vec3 norm = glm::vec3(block.nx[best % 4], block.ny[best % 4], block.nz[best % 4]);
+		glm::vec3 sphere_at = glm::mix(sphere_from, sphere_to, best_t);
+		at = sphere_at + (block.offset[best % 4] - glm::dot(norm, sphere_at)) * norm;
+		out = careful_normalize(sphere_at - at);
+	} else if (best_feature <= EdgeCA) {
+		glm::vec3 cylinder_a = (best_feature == EdgeAB ? a : (best_feature == EdgeBC ? b : c));
+		glm::vec3 cylinder_b = (best_feature == EdgeAB ? b : (best_feature == EdgeBC ? c : a));
+		glm::vec3 cy_axis = cylinder_b - cylinder_a;
+		float cy_height = glm::dot(cy_axis, cy_axis);
+		float dot_from = glm::dot(sphere_from - cylinder_a, cy_axis);
+		float dot_to = glm::dot(sphere_from + dir1 - cylinder_a, cy_axis);
+		glm::vec3 projected_pt = cylinder_a + dot_from * cy_axis / cy_height;
+		glm::vec3 projected_dir = (dot_to - dot_from) * cy_axis / cy_height;
+		out = careful_normalize(sphere_from - projected_pt + best_t * (dir1 - projected_dir));
+		at = sphere_from + best_t * dir1 - sphere_radius * out;
+	} else {
+		glm::vec3 point = (best_feature == VertexA ? a : (best_feature == VertexB ? b : c));
+		at = point;
+		out = careful_normalize(sphere_from + best_t * dir1 - point);
+	}
+	*at_ = at;
+	*out_ = out;
+}
+
+} //unnamed namespace
+
+uint32_t collide_swept_sphere_vs_triangles(
+	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
+	PackedTriangles const &triangles,
+	float *collision_t, glm::vec3 *collision_at, glm::vec3 *collision_out
+) {
+	float best_t = 1.0f;
+	if (collision_t) {
+		best_t = std::min(best_t, *collision_t);
+		if (best_t <= 0.0f) return -1U;
+	}
+	uint32_t best_feature = Face;
+	uint32_t best = first_contact(sphere_from, sphere_to, sphere_radius, triangles, 0, uint32_t(triangles.blocks.size()), &best_t, &best_feature);
+	if (best == -1U) return -1U;
+
+	//work out contact details for the winning triangle and feature:
+	glm::vec3 at, out;
+	contact_details(sphere_from, sphere_to, sphere_radius, triangles, best, best_feature, best_t, &at, &out);
+
+	if (collision_t) *collision_t = best_t;
+	if (collision_at) *collision_at = at;
+	if (collision_out) *collision_out = out;
+	return best;
+}
+
+uint32_t collide_swept_sphere_vs_triangles_parallel(
+	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
+	PackedTriangles const &triangles,
+	float *collision_t, glm::vec3 *collision_at, glm::vec3 *collision_out,
+	uint32_t grain
+) {
+	uint32_t blocks = uint32_t(triangles.blocks.size());
+	uint32_t grain_blocks = std::max(1U, grain / 4);
+	if (blocks <= grain_blocks) {
+		return collide_swept_sphere_vs_triangles(sphere_from, sphere_to, sphere_radius, triangles, collision_t, collision_at, collision_out);
+	}
+
+	float start_t = 1.0f;
+	if (collision_t) {
+		start_t = std::min(start_t, *collision_t);
+		if (start_t <= 0.0f) return -1U;
+	}
+
+	//each chunk of (grain * 4) triangles finds its own earliest contact...
+	struct Contact {
+		float t;
+		uint32_t index;
+		uint32_t feature;
+	};
+	std::vector< Contact > chunks((blocks + grain_blocks - 1) / grain_blocks);
+	Parallel::for_range(blocks, grain_blocks, [&](uint32_t begin, uint32_t end) {
+		Contact &contact = chunks[begin / grain_blocks];
+		contact.t = start_t;
+		contact.feature = Face;
+		contact.index = first_contact(sphere_from, sphere_to, sphere_radius, triangles, begin, end, &contact.t, &contact.feature);
+	});
+
+	//...then chunks are combined in order, so ties go to the later triangle (as in collide_swept_sphere_vs_triangles):
+	Contact best{start_t, -1U, Face};
+	for (auto const &contact : chunks) {
+		if (best.t <= 0.0f) break;
+		if (contact.index != -1U && contact.t <= best.t) best = contact;
+	}
+	if (best.index == -1U) return -1U;
+
+	glm::vec3 at, out;
+	contact_details(sphere_from, sphere_to, sphere_radius, triangles, best.index, best.feature, best.t, &at, &out);
+
+	if (collision_t) *collision_t = best.t;
+	if (collision_at) *collision_at = at;
+	if (collision_out) *collision_out = out;
+	return best.index;
+}
+
+//------------------------------------------------
+//Oriented boxes:
+
+bool collide_swept_sphere_vs_box(
+	glm::vec3 const &sphere_from, glm::vec3 const &sphere_to, float sphere_radius,
+	CollisionBox const &box,
+	float *collision_t, glm::vec3 *collision_at, glm::vec3 *collision_out
+) {
+	float t = 1.0f;
+	if (collision_t) {
+		t = std::min(t, *collision_t);
+		if (t <= 0.0f) return false;
+	}
+
+	//work in the box's frame, where the box is [-e,e]:
+	glm::mat3 box_to_world = glm::mat3(box.axes[0], box.axes[1], box.axes[2]);
+	glm::mat3 world_to_box = glm::transpose(box_to_world);
+	glm::vec3 from = world_to_box * (sphere_from - box.center);
+	glm::vec3 dir = world_to_box * (sphere_to - sphere_from);
+	glm::vec3 const &e = box.half_extents;
+	float r = sphere_radius;
+
+	float hit_t = t;
+	glm::vec3 at, out;
+
+	glm::vec3 closest = glm::clamp(from, -e, e);
+	if (glm::dot(from - closest, from - closest) <= r * r) {
+		//already touching:
+		if (from != closest) {
+			out = glm::normalize(from - closest);
+		} else {
+			//center inside box, so push out through the nearest side:
+			uint32_t axis = 0;
+			for (uint32_t i = 1; i < 3; ++i) {
+				if (e[i] - std::abs(from[i]) < e[axis] - std::abs(from[axis])) axis = i;
+			}
+			out = glm::vec3(0.0f);
+			out[axis] = (from[axis] < 0.0f ? -1.0f : 1.0f);
+			closest[axis] = out[axis] * e[axis];
+		}
+		//(spheres moving away are allowed to leave)
+		if (!(glm::dot(dir, out) < 0.0f)) return false;
+		hit_t = 0.0f;
+		at = closest;
+	} else {
+		//find where the center enters the box grown by the radius on each side:
+		float t0 = 0.0f;
+		float t1 = t;
+		uint32_t enter_axis = 3;
+		for (uint32_t i = 0; i < 3; ++i) {
+			float lo = -e[i] - r;
+			float hi = e[i] + r;
+			if (dir[i] == 0.0f) {
+				if (from[i] < lo || from[i] > hi) return false;
+				continue;
+			}
+			float a = (lo - from[i]) / dir[i];
+			float b = (hi - from[i]) / dir[i];
+			if (a > b) std::swap(a, b);
+			if (a > t0) {
+				t0 = a;
+				enter_axis = i;
+			}
+			t1 = std::min(t1, b);
+			if (t0 > t1) return false;
+		}
+
+		//which sides of the (un-grown) box the center is beyond at that point:
+		glm::vec3 p = from + t0 * dir;
+		uint32_t beyond = 0;
+		uint32_t beyond_count = 0;
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (p[i] < -e[i] || p[i] > e[i]) {
+				beyond |= (1 << i);
+				beyond_count += 1;
+			}
+		}
+
+		if (beyond_count <= 1 && enter_axis < 3) {
+			//entered through a side:
+			hit_t = t0;
+			out = glm::vec3(0.0f);
+			out[enter_axis] = (p[enter_axis] < 0.0f ? -1.0f : 1.0f);
+			at = glm::clamp(p, -e, e);
+		} else {
+			//entered near an edge or corner, where the grown box is rounded; so check the edge(s) there as capsules:
+			// (as in Ericson, "Real-Time Collision Detection", 5.5.7)
+			glm::vec3 corner = glm::vec3(p.x < 0.0f ? -e.x : e.x, p.y < 0.0f ? -e.y : e.y, p.z < 0.0f ? -e.z : e.z);
+			bool collided = false;
+			for (uint32_t k = 0; k < 3; ++k) {
+				//near an edge: only the edge along the axis the center is within; near a corner: all three edges through it
+				if (beyond_count != 3 && (beyond & (1 << k))) continue;
+				glm::vec3 edge_a = corner;
+				glm::vec3 edge_b = corner;
+				edge_a[k] = -e[k];
+				edge_b[k] = e[k];
+				if (collide_ray_vs_cylinder(from, dir, edge_a, edge_b, r, &hit_t, &at, &out)) collided = true;
+				if (collide_swept_sphere_vs_point(from, from + dir, r, edge_a, &hit_t, &at, &out)) collided = true;
+				if (collide_swept_sphere_vs_point(from, from + dir, r, edge_b, &hit_t, &at, &out)) collided = true;
+			}
+			if (!collided) return false;
+		}
+	}
+
+	if (collision_t) *collision_t = hit_t;
+	if (collision_at) *collision_at = box.center + box_to_world * at;
+	if (collision_out) *collision_out = box_to_world * out;
+	return true;
+}
+
+bool triangles_form_box(
+	std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, uint32_t first, uint32_t count,
+	glm::vec3 *min_, glm::vec3 *max_
+) {
+	assert(min_ && max_);
+	//two triangles for each of six sides:
+	if (count != 36 || uint64_t(first) + count > indices.size()) return false;
+
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (uint32_t i = first; i < first + count; ++i) {
+		if (indices[i] >= positions.size()) return false;
+		min = glm::min(min, positions[indices[i]]);
+		max = glm::max(max, positions[indices[i]]);
+	}
+	glm::vec3 size = max - min;
+	float eps = 1e-4f * std::max(size.x, std::max(size.y, size.z));
+	if (!(size.x > eps && size.y > eps && size.z > eps)) return false;
+
+	//every vertex must be a corner of the box; corner bit i is set when the vertex is on the max side of axis i:
+	auto corner_of = [&](glm::vec3 const &p, uint32_t *corner) {
+		*corner = 0;
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (std::abs(p[i] - max[i]) <= eps) *corner |= (1 << i);
+			else if (!(std::abs(p[i] - min[i]) <= eps)) return false;
+		}
+		return true;
+	};
+
+	//each side (2*axis + max-ness) must be covered by two triangles, missing opposite corners of the side:
+	uint32_t side_triangles[6] = {0, 0, 0, 0, 0, 0};
+	uint32_t side_missing[6] = {0, 0, 0, 0, 0, 0}; //xor of the missing corners
+	for (uint32_t v = first; v < first + count; v += 3) {
+		glm::vec3 const &a = positions[indices[v+0]];
+		glm::vec3 const &b = positions[indices[v+1]];
+		glm::vec3 const &c = positions[indices[v+2]];
+		uint32_t ca, cb, cc;
+		if (!corner_of(a, &ca) || !corner_of(b, &cb) || !corner_of(c, &cc)) return false;
+		if (ca == cb || cb == cc || cc == ca) return false;
+
+		//three different corners of a box share at most one side:
+		uint32_t shared_max = ca & cb & cc;
+		uint32_t shared_min = ~(ca | cb | cc) & 7;
+		uint32_t shared = shared_max | shared_min;
+		if (shared != 1 && shared != 2 && shared != 4) return false;
+		uint32_t axis = (shared == 1 ? 0 : (shared == 2 ? 1 : 2));
+		uint32_t side = 2 * axis + (shared_max ? 1 : 0);
+
+		//must face out of the box:
+		float facing = glm::cross(b - a, c - a)[axis];
+		if (!(shared_max ? facing > 0.0f : facing < 0.0f)) return false;
+
+		//the side's fourth corner (as a two-bit index over the other two axes):
+		auto on_side = [axis](uint32_t corner) {
+			uint32_t low = corner & ((1 << axis) - 1);
+			uint32_t high = corner >> (axis + 1);
+			return low | (high << axis);
+		};
+		side_triangles[side] += 1;
+		side_missing[side] ^= 6 - on_side(ca) - on_side(cb) - on_side(cc);
+	}
+	for (uint32_t side = 0; side < 6; ++side) {
+		if (side_triangles[side] != 2 || side_missing[side] != 3) return false;
+	}
+
+	*min_ = min;
+	*max_ = max;
+	return true;
+}
@@ -2,6 +2,9 @@
 
 #include <glm/glm.hpp>
 
+#include <vector>
+#include <cstdint>
+
 //Collision functions:
 
 //Check if two Axis-Aligned Bounding Boxes overlap:
@@ -28,10 +31,123 @@ bool collide_swept_sphere_vs_triangle(
 	glm::vec3 *collision_out = nullptr //[optional,out] direction to move sphere to get away from triangle as quickly as possible (basically, the outward normal)
 );
 
+//Check two spheres moving at the same time:
+// returns 'true' on collision
 bool collide_swept_sphere_vs_swept_sphere(
 	glm::vec3 const &sphere0_from, glm::vec3 const &sphere0_to, float sphere0_radius,
 	glm::vec3 const &sphere1_from, glm::vec3 const &sphere1_to, float sphere1_radius,
-	float *collision_t = nullptr, //[optional,in+out] first time where sphere touches triangle
-	glm::vec3 *collision_at = nullptr, //[optional,out] point where sphere touches triangle
-	glm::vec3 *collision_out = nullptr
+	float *collision_t = nullptr, //[optional,in+out] first time where the spheres touch
+	glm::vec3 *collision_at = nullptr, //[optional,out] point where the spheres touch
+	glm::vec3 *collision_out = nullptr //[optional,out] direction to move sphere0 to get away from sphere1 as quickly as possible
+);
+
+//A triangle with the data collision queries need precomputed:
+struct CollisionTriangle {
+	glm::vec3 a, b, c;
+	glm::vec3 normal; //unit normal, cross(b-a, c-a) direction
+	float offset; //plane is dot(normal, x) == offset
+	glm::vec4 edge_planes[3]; //planes through edges ab, bc, ca, perpendicular to the triangle; (xyz,w) is (inward unit normal, offset)
+	//edges and vertices the sphere might touch before touching any face:
+	enum : uint32_t {
+		EdgeAB = 1, EdgeBC = 2, EdgeCA = 4,
+		VertexA = 8, VertexB = 16, VertexC = 32,
+		AllFeatures = 63
+	};
+	uint32_t features = AllFeatures;
+};
+
+//build a record for a single triangle (with all features marked):
+CollisionTriangle make_collision_triangle(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c);
+
+//clear feature flags of edges that are flat or concave in a triangle mesh, and of vertices with no convex edges:
+// (so internal edges of smooth surfaces don't cause bumps)
+// convexity is judged from the front (normal) side, so spheres approaching from behind may snag on skipped edges.
+// triangles sharing an edge must share its endpoints (to within welding_distance) and have consistent winding;
+// boundary edges and anything else ambiguous is left marked.
+void mark_convex_features(std::vector< CollisionTriangle > *triangles, float welding_distance = 1e-4f);
+
+//Triangles packed four at a time (structure-of-arrays), for collide_swept_sphere_vs_triangles:
+struct PackedTriangles {
+	struct Block {
+		//triangle i of the block is (ax[i],ay[i],az[i]), (bx[i],by[i],bz[i]), (cx[i],cy[i],cz[i]):
+		float ax[4], ay[4], az[4];
+		float bx[4], by[4], bz[4];
+		float cx[4], cy[4], cz[4];
+		//precomputed plane and edge planes (as in CollisionTriangle):
+		float nx[4], ny[4], nz[4], offset[4];
+		float ex[3][4], ey[3][4], ez[3][4], eoffset[3][4];
+		uint32_t features[4];
+	};
+	std::vector< Block > blocks;
+	uint32_t count = 0; //triangles in blocks (unused slots at the end of the last block are degenerate)
+
+	void clear();
+	void push_back(CollisionTriangle const &triangle);
+	void push_back(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c); //(with all features)
+	glm::vec3 a(uint32_t i) const;
+	glm::vec3 b(uint32_t i) const;
+	glm::vec3 c(uint32_t i) const;
+};
+
+//Check a swept sphere vs many triangles at once (four per SIMD operation):
+// returns the index of the triangle with the earliest collision, or -1U if none.
+// results match calling collide_swept_sphere_vs_triangle on each triangle in turn,
+// except that edges and vertices not marked in a triangle's features are skipped.
+// (so ties go to the later triangle, except that nothing replaces a collision at t = 0)
+uint32_t collide_swept_sphere_vs_triangles(
+	//swept sphere:
+	glm::vec3 const &sphere_from,
+	glm::vec3 const &sphere_to,
+	float sphere_radius,
+	//triangles:
+	PackedTriangles const &triangles,
+	//output:
+	float *collision_t = nullptr, //[optional,in+out] first time where sphere touches a triangle
+	glm::vec3 *collision_at = nullptr, //[optional,out] point where sphere touches that triangle
+	glm::vec3 *collision_out = nullptr //[optional,out] direction to move sphere to get away from that triangle as quickly as possible
+);
+
+//Same as collide_swept_sphere_vs_triangles, but splits the triangles into chunks of about 'grain' that run on Parallel's workers:
+// each chunk finds its own earliest collision, then chunks are combined in order with the same tie rule,
+// so results are identical to collide_swept_sphere_vs_triangles. (Runs on the calling thread if there's only one chunk.)
+uint32_t collide_swept_sphere_vs_triangles_parallel(
+	glm::vec3 const &sphere_from,
+	glm::vec3 const &sphere_to,
+	float sphere_radius,
+	PackedTriangles const &triangles,
+	float *collision_t = nullptr,
+	glm::vec3 *collision_at = nullptr,
+	glm::vec3 *collision_out = nullptr,
+	uint32_t grain = 256
+);
+
+//A solid box with its own orientation (e.g., a block-shaped collider placed in the world):
+struct CollisionBox {
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 axes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) }; //orthonormal
+	glm::vec3 half_extents = glm::vec3(0.0f); //half-size along each axis
+};
+
+//Check a swept sphere vs a solid box:
+// returns 'true' on collision
+// spheres that start out touching the box collide at t = 0 unless they are moving away from it.
+bool collide_swept_sphere_vs_box(
+	//swept sphere:
+	glm::vec3 const &sphere_from,
+	glm::vec3 const &sphere_to,
+	float sphere_radius,
+	//box:
+	CollisionBox const &box,
+	//output:
+	float *collision_t = nullptr, //[optional,in+out] first time where sphere touches box
+	glm::vec3 *collision_at = nullptr, //[optional,out] point where sphere touches box
+	glm::vec3 *collision_out = nullptr //[optional,out] direction to move sphere to get away from box as quickly as possible
+);
+
+//Check if triangles positions[indices[first + 3*t + i]] for t in [0, count / 3) exactly cover the surface of an axis-aligned box:
+// (two outward-facing triangles per side, all corners at box corners)
+// returns 'true' and sets [*min, *max] to the box if so.
+bool triangles_form_box(
+	std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, uint32_t first, uint32_t count,
+	glm::vec3 *min, glm::vec3 *max
 );
@@ -0,0 +1,186 @@
+#include "BubbleLevel.hpp"
+#include "load_save_pnct.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <tuple>
+#include <iostream>
+#include <fstream>
+#include <limits>
+
+/*
+ * cook a Bubble 3D level:
+ *  reads a '.scene' and the '.pnct' its meshes come from, resolves mesh names to
+ *  vertex ranges, sorts out which drawables are solid, bakes the colliders'
+ *  triangles into world space, and writes it all out in the layout BubbleLevel's
+ *  constructor expects.
+ *  (see BubbleLevel::Cooked for the file format)
+ */
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try { //windows doesn't print nice errors for unhandled exceptions, so we need to.
+#endif
+	if (argc != 4) {
+		std::cerr << "Usage:\n\t./cook-level <meshes.pnct> <level.scene> <out.level>\n";
+		std::cerr << " will resolve the meshes used by \"level.scene\" against \"meshes.pnct\" and write \"out.level\".\n";
+		std::cerr.flush();
+		return 1;
+	}
+	std::string pnct_file = argv[1];
+	std::string scene_file = argv[2];
+	std::string out_file = argv[3];
+
+	//---- read meshes ----
+	PnctFile pnct;
+	load_pnct(pnct_file, &pnct);
+	//(MeshBuffer does the same, so ranges below are index ranges in its index buffer)
+	index_pnct(&pnct);
+
+	std::unordered_map< std::string, uint32_t > mesh_by_name;
+	for (uint32_t i = 0; i < pnct.meshes.size(); ++i) {
+		mesh_by_name.insert(std::make_pair(pnct.meshes[i].name, i));
+	}
+
+	//---- read scene ----
+	struct SceneDrawable {
+		Scene::Transform *transform;
+		uint32_t mesh; //index in pnct.meshes
+	};
+	std::vector< SceneDrawable > scene_drawables;
+
+	Scene scene;
+	scene.load(scene_file, [&](Scene &, Scene::Transform *transform, std::string const &mesh_name){
+		auto f = mesh_by_name.find(mesh_name);
+		if (f == mesh_by_name.end()) {
+			throw std::runtime_error("Scene '" + scene_file + "' uses mesh '" + mesh_name + "' that isn't in '" + pnct_file + "'.");
+		}
+		scene_drawables.emplace_back(SceneDrawable{transform, f->second});
+	});
+
+	//---- transforms ----
+	std::vector< char > names;
+	std::vector< BubbleLevel::Cooked::Transform > hierarchy;
+	std::unordered_map< Scene::Transform const *, uint32_t > transform_index;
+	//(Scene::load emplaces transforms in topological order, so this keeps parents first)
+	for (auto const &t : scene.transforms) {
+		BubbleLevel::Cooked::Transform h;
+		h.parent = -1U;
+		if (t.parent) h.parent = transform_index.at(t.parent);
+		h.name_begin = uint32_t(names.size());
+		names.insert(names.end(), t.name.begin(), t.name.end());
+		h.name_end = uint32_t(names.size());
+		h.position = t.position;
+		h.rotation = t.rotation;
+		h.scale = t.scale;
+		transform_index.insert(std::make_pair(&t, uint32_t(hierarchy.size())));
+		hierarchy.emplace_back(h);
+	}
+
+	//---- ranges (only those used) ----
+	std::vector< BubbleLevel::Cooked::Range > ranges;
+	std::unordered_map< uint32_t, uint32_t > range_for_mesh;
+	auto get_range = [&](uint32_t mesh) -> uint32_t {
+		auto f = range_for_mesh.find(mesh);
+		if (f != range_for_mesh.end()) return f->second;
+
+		PnctFile::Mesh const &m = pnct.meshes[mesh];
+		BubbleLevel::Cooked::Range r;
+		r.type = GL_TRIANGLES;
+		r.start = m.vertex_begin;
+		r.count = m.vertex_end - m.vertex_begin;
+		r.min = glm::vec3( std::numeric_limits< float >::infinity());
+		r.max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (uint32_t i = m.vertex_begin; i < m.vertex_end; ++i) {
+			r.min = glm::min(r.min, pnct.vertices[pnct.indices[i]].Position);
+			r.max = glm::max(r.max, pnct.vertices[pnct.indices[i]].Position);
+		}
+		range_for_mesh.insert(std::make_pair(mesh, uint32_t(ranges.size())));
+		ranges.emplace_back(r);
+		return uint32_t(ranges.size()) - 1;
+	};
+
+	//---- drawables + colliders ----
+	std::vector< BubbleLevel::Cooked::Drawable > drawables;
+	std::vector< BubbleLevel::Cooked::Collider > colliders;
+	//world-space triangles of the colliders (positions deduplicated by value):
+	std::vector< glm::vec3 > collision_positions;
+	std::vector< uint32_t > collision_indices;
+	std::map< std::tuple< float, float, float >, uint32_t > collision_position_index;
+	for (auto const &sd : scene_drawables) {
+		BubbleLevel::Cooked::Drawable d;
+		d.transform = transform_index.at(sd.transform);
+		d.range = get_range(sd.mesh);
+		d.pipeline = BubbleLevel::Cooked::PipelineLitColorTexture;
+		drawables.emplace_back(d);
+
+		//bubbles and bullets are spawned at runtime; everything else in a level is solid:
+		std::string const &name = pnct.meshes[sd.mesh].name;
+		if (name == "Bubble" || name == "Bullet") continue;
+
+		BubbleLevel::Cooked::Range const &r = ranges[d.range];
+		if (r.count == 0) continue;
+
+		BubbleLevel::Cooked::Collider c;
+		c.transform = d.transform;
+		c.range = d.range;
+		colliders.emplace_back(c);
+
+		glm::mat4x3 to_world = sd.transform->make_local_to_world();
+		PnctFile::Mesh const &m = pnct.meshes[sd.mesh];
+		for (uint32_t i = m.vertex_begin; i + 2 < m.vertex_end; i += 3) {
+			glm::vec3 corners[3];
+			for (uint32_t j = 0; j < 3; ++j) {
+				corners[j] = to_world * glm::vec4(pnct.vertices[pnct.indices[i+j]].Position, 1.0f);
+			}
+			//(degenerate triangles can't be collided with, so leave them out)
+			if (glm::cross(corners[1] - corners[0], corners[2] - corners[0]) == glm::vec3(0.0f)) continue;
+			for (uint32_t j = 0; j < 3; ++j) {
+				auto f = collision_position_index.insert(std::make_pair(std::make_tuple(corners[j].x, corners[j].y, corners[j].z), uint32_t(collision_positions.size())));
+				if (f.second) collision_positions.emplace_back(corners[j]);
+				collision_indices.emplace_back(f.first->second);
+			}
+		}
+	}
+
+	//---- write ----
+	//pad strings so that following chunks stay 4-byte aligned (and can be read in place from a mapping):
+	names.resize((names.size() + 3) & ~size_t(3), '\0');
+
+	std::ofstream out(out_file, std::ios::binary);
+	write_chunk("str0", names, &out);
+	write_chunk("xfh0", hierarchy, &out);
+	write_chunk("rng0", ranges, &out);
+	write_chunk("drw0", drawables, &out);
+	write_chunk("col0", colliders, &out);
+	write_chunk("ctp0", collision_positions, &out);
+	write_chunk("cti0", collision_indices, &out);
+	if (!out) {
+		std::cerr << "ERROR: failed to write '" << out_file << "'." << std::endl;
+		return 1;
+	}
+
+	std::cout << "Wrote '" << out_file << "': "
+		<< hierarchy.size() << " transforms, "
+		<< ranges.size() << " mesh ranges, "
+		<< drawables.size() << " drawables, "
+		<< colliders.size() << " colliders, "
+		<< collision_indices.size() / 3 << " collision triangles."
+		<< std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
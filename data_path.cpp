@@ -57,9 +57,17 @@ static std::string get_exe_path() {
 	#endif
 }
 
-std::string data_path(std::string const &suffix) {
+static std::string &data_path_base() {
 	static std::string path = get_exe_path(); //cache result of get_exe_path()
-	return path + "/" + suffix;
+	return path;
+}
+
+std::string data_path(std::string const &suffix) {
+	return data_path_base() + "/" + suffix;
+}
+
+void set_data_path(std::string const &path) {
+	data_path_base() = path;
 }
 
 /* From Rktcr; to be used eventually!
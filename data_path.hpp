@@ -5,3 +5,6 @@
 //construct a path based on the location of the currently-running executable:
 // (e.g. if running /home/ix/game0/game.exe will return '/home/ix/game0/' + suffix)
 std::string data_path(std::string const &suffix);
+
+//make data_path look somewhere else (e.g. for tools that aren't built into the game's directory):
+void set_data_path(std::string const &path);
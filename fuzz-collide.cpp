@@ -0,0 +1,828 @@
+#include "collide.hpp"
+#include "CollisionWorld.hpp"
+#include "Parallel.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/*
+ * fuzz-collide checks the functions in collide.hpp over random cases:
+ *  - collide_AABB_vs_AABB, collide_swept_sphere_vs_swept_sphere, and
+ *    collide_swept_sphere_vs_triangle against slow reference versions
+ *    (which step along the sweep and measure distances), including how
+ *    they treat the optional collision_t/at/out pointers;
+ *  - collide_swept_sphere_vs_triangles against calling
+ *    collide_swept_sphere_vs_triangle on each triangle in turn, and
+ *    collide_swept_sphere_vs_triangles_parallel against it;
+ *  - that skipping the non-convex edges and vertices of a mesh
+ *    (mark_convex_features) doesn't change when a sphere hits it, and that
+ *    spheres rolling over a flat mesh don't bump on its internal edges;
+ *  - collide_swept_sphere_vs_box against a reference and against the twelve
+ *    triangles it replaces, and triangles_form_box on box and non-box meshes;
+ *  - CollisionWorld's batched queries against one-at-a-time queries and
+ *    against testing every triangle and box in the world.
+ * It then reports queries per second for each function.
+ * Usage: ./fuzz-collide [iterations] [seed]
+ *  (iterations is the number of cases for the fast functions; slower checks run fewer)
+ */
+
+//results are compared with this (absolute) tolerance:
+constexpr float Tolerance = 1e-3f;
+
+//------------------------------------------------
+//Random inputs:
+
+struct Scenario {
+	glm::vec3 from, to;
+	float radius;
+	std::vector< glm::vec3 > triangles; //three vertices per triangle
+};
+
+Scenario random_scenario(std::mt19937 &mt, uint32_t max_triangles) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto point = [&](float scale) {
+		return scale * glm::vec3(unit(mt), unit(mt), unit(mt));
+	};
+
+	Scenario s;
+	s.from = point(2.0f);
+	s.to = point(2.0f);
+	if (mt() % 8 == 0) s.to = s.from + point(0.01f); //very short sweeps
+	s.radius = 0.05f + 0.5f * (unit(mt) + 1.0f);
+
+	uint32_t count = 1 + mt() % max_triangles;
+	for (uint32_t t = 0; t < count; ++t) {
+		//triangles of a few different sizes, centered near the sweep:
+		glm::vec3 center = glm::mix(s.from, s.to, 0.5f * (unit(mt) + 1.0f)) + point(1.0f);
+		float size = (mt() % 3 == 0 ? 0.1f : (mt() % 2 ? 1.0f : 4.0f));
+		glm::vec3 a = center + point(size);
+		glm::vec3 b = center + point(size);
+		glm::vec3 c = center + point(size);
+		//skip nearly-degenerate triangles (their normals aren't meaningful):
+		glm::vec3 perp = glm::cross(b - a, c - a);
+		if (glm::length(perp) < 1e-3f * size * size) {
+			--t;
+			continue;
+		}
+		//...and sweeps that start on or run along the triangle's plane (where which side the sphere is on is down to rounding):
+		glm::vec3 norm = glm::normalize(perp);
+		if (std::abs(glm::dot(norm, s.from - a)) < 1e-3f || std::abs(glm::dot(norm, s.to - s.from)) < 1e-3f * glm::length(s.to - s.from)) {
+			--t;
+			continue;
+		}
+		s.triangles.emplace_back(a);
+		s.triangles.emplace_back(b);
+		s.triangles.emplace_back(c);
+	}
+	return s;
+}
+
+//a grid of (GridSize x GridSize) cells over [-2,2]^2, two triangles per cell, with random heights (or flat):
+constexpr uint32_t GridSize = 6;
+std::vector< glm::vec3 > random_heightfield(std::mt19937 &mt, bool flat) {
+	std::uniform_real_distribution< float > height(-0.5f, 0.5f);
+	std::vector< glm::vec3 > grid;
+	for (uint32_t y = 0; y <= GridSize; ++y) {
+		for (uint32_t x = 0; x <= GridSize; ++x) {
+			grid.emplace_back(4.0f * x / GridSize - 2.0f, 4.0f * y / GridSize - 2.0f, (flat ? 0.0f : height(mt)));
+		}
+	}
+	std::vector< glm::vec3 > triangles;
+	for (uint32_t y = 0; y < GridSize; ++y) {
+		for (uint32_t x = 0; x < GridSize; ++x) {
+			glm::vec3 const &p00 = grid[y*(GridSize+1)+x];
+			glm::vec3 const &p10 = grid[y*(GridSize+1)+x+1];
+			glm::vec3 const &p01 = grid[(y+1)*(GridSize+1)+x];
+			glm::vec3 const &p11 = grid[(y+1)*(GridSize+1)+x+1];
+			triangles.insert(triangles.end(), {p00, p10, p11});
+			triangles.insert(triangles.end(), {p00, p11, p01});
+		}
+	}
+	return triangles;
+}
+
+//a box with random size and orientation near the origin:
+CollisionBox random_box(std::mt19937 &mt) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	CollisionBox box;
+	box.center = glm::vec3(unit(mt), unit(mt), unit(mt));
+	if (mt() % 4 != 0) {
+		//(a quarter stay axis-aligned, like most level blocks)
+		glm::vec3 x = glm::normalize(glm::vec3(unit(mt), unit(mt), unit(mt)) + glm::vec3(1e-3f, 0.0f, 0.0f));
+		glm::vec3 y = glm::vec3(unit(mt), unit(mt), unit(mt)) + glm::vec3(0.0f, 1e-3f, 0.0f);
+		y = glm::normalize(y - glm::dot(y, x) * x);
+		box.axes[0] = x;
+		box.axes[1] = y;
+		box.axes[2] = glm::cross(x, y);
+	}
+	box.half_extents = glm::vec3(0.1f) + 0.7f * (glm::vec3(unit(mt), unit(mt), unit(mt)) + glm::vec3(1.0f));
+	return box;
+}
+
+//the twelve (outward-facing) triangles on the surface of a box, with randomly chosen diagonals and starting corners:
+std::vector< glm::vec3 > box_triangles(std::mt19937 &mt, CollisionBox const &box) {
+	auto corner = [&box](uint32_t i) {
+		glm::vec3 ret = box.center;
+		for (uint32_t k = 0; k < 3; ++k) {
+			ret += ((i & (1 << k)) ? 1.0f : -1.0f) * box.half_extents[k] * box.axes[k];
+		}
+		return ret;
+	};
+	std::vector< glm::vec3 > triangles;
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		for (uint32_t side = 0; side < 2; ++side) {
+			//corners of this side, counterclockwise seen from outside:
+			uint32_t u = 1 << ((axis + 1) % 3), v = 1 << ((axis + 2) % 3);
+			uint32_t base = (side ? (1 << axis) : 0);
+			uint32_t quad[4] = {base, base | u, base | u | v, base | v};
+			if (!side) std::swap(quad[1], quad[3]);
+			uint32_t d = mt() % 2; //which diagonal
+			uint32_t tris[2][3] = {{quad[d], quad[d+1], quad[(d+2)%4]}, {quad[d], quad[(d+2)%4], quad[(d+3)%4]}};
+			for (auto const &tri : tris) {
+				uint32_t r = mt() % 3;
+				for (uint32_t i = 0; i < 3; ++i) triangles.emplace_back(corner(tri[(i + r) % 3]));
+			}
+		}
+	}
+	return triangles;
+}
+
+//closest point to p on (or in) a box:
+glm::vec3 closest_point_on_box(glm::vec3 const &p, CollisionBox const &box) {
+	glm::vec3 ret = box.center;
+	for (uint32_t k = 0; k < 3; ++k) {
+		float d = glm::dot(p - box.center, box.axes[k]);
+		ret += glm::clamp(d, -box.half_extents[k], box.half_extents[k]) * box.axes[k];
+	}
+	return ret;
+}
+
+//a value to pass in *collision_t (mostly "no limit", sometimes cutting the sweep short, sometimes already used up):
+float random_limit(std::mt19937 &mt) {
+	uint32_t r = mt() % 8;
+	if (r == 0) return 0.5f;
+	if (r == 1) return 0.0f;
+	return 2.0f;
+}
+
+bool close(float a, float b, float tolerance = Tolerance) {
+	return std::abs(a - b) <= tolerance;
+}
+bool close(glm::vec3 const &a, glm::vec3 const &b, float tolerance = Tolerance) {
+	return close(a.x, b.x, tolerance) && close(a.y, b.y, tolerance) && close(a.z, b.z, tolerance);
+}
+
+std::string str(glm::vec3 const &v) {
+	return std::to_string(v.x) + ", " + std::to_string(v.y) + ", " + std::to_string(v.z);
+}
+
+//counts (and prints the first few) mismatches for one check:
+struct Check {
+	Check(std::string const &name_) : name(name_) { }
+	std::string name;
+	uint32_t cases = 0;
+	uint32_t hits = 0;
+	uint32_t skipped = 0; //cases too close to call (e.g., grazing contacts)
+	uint32_t mismatches = 0;
+	void report(uint32_t index, std::string const &what) {
+		if (mismatches < 5) {
+			std::cerr << name << ", case " << index << ": " << what << std::endl;
+		}
+		mismatches += 1;
+	}
+	void summary() const {
+		std::cout << "  " << std::left << std::setw(46) << name << std::right
+			<< std::setw(9) << cases << " cases, " << std::setw(8) << hits << " hits, "
+			<< std::setw(6) << skipped << " skipped, " << mismatches << " mismatches" << std::endl;
+	}
+};
+
+//------------------------------------------------
+//Slow references:
+
+//closest point to p on triangle abc (from Ericson, "Real-Time Collision Detection", 5.1.5):
+glm::vec3 closest_point_on_triangle(glm::vec3 const &p, glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + (d1 / (d1 - d3)) * ab;
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + (d2 / (d2 - d6)) * ac;
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+//first time in [0, limit] where gap(t) <= 0, found by stepping then bisecting:
+// 'margin' is how much gap can change within one step; if a step comes that close to
+// touching without touching (or the answer is right at 'limit'), the result is marked ambiguous.
+constexpr uint32_t ReferenceSteps = 512;
+template< typename Gap >
+bool reference_first_contact(Gap const &gap, float limit, float margin, float *t, bool *ambiguous) {
+	*ambiguous = false;
+	if (!(limit > 0.0f)) return false;
+	if (gap(0.0f) <= 0.0f) {
+		*t = 0.0f;
+		return true;
+	}
+	float before = 0.0f;
+	for (uint32_t step = 1; step <= ReferenceSteps; ++step) {
+		float after = limit * step / ReferenceSteps;
+		float g = gap(after);
+		if (g <= 0.0f) {
+			for (uint32_t iter = 0; iter < 40; ++iter) {
+				float mid = 0.5f * (before + after);
+				if (gap(mid) <= 0.0f) after = mid;
+				else before = mid;
+			}
+			*t = after;
+			if (limit - after < 1e-4f) *ambiguous = true;
+			return true;
+		}
+		if (g < margin) *ambiguous = true;
+		before = after;
+	}
+	return false;
+}
+
+//------------------------------------------------
+//Checks:
+
+void check_AABB_vs_AABB(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	//(coordinates on a half-unit grid, so boxes often touch exactly)
+	std::uniform_int_distribution< int32_t > coord(-6, 6);
+	auto box = [&](glm::vec3 *min, glm::vec3 *max) {
+		glm::vec3 a = 0.5f * glm::vec3(coord(mt), coord(mt), coord(mt));
+		glm::vec3 b = 0.5f * glm::vec3(coord(mt), coord(mt), coord(mt));
+		*min = glm::min(a, b);
+		*max = glm::max(a, b);
+	};
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		glm::vec3 a_min, a_max, b_min, b_max;
+		box(&a_min, &a_max);
+		box(&b_min, &b_max);
+		//reference: intervals overlap on every axis:
+		bool expected = true;
+		for (uint32_t i = 0; i < 3; ++i) {
+			if (std::max(a_min[i], b_min[i]) > std::min(a_max[i], b_max[i])) expected = false;
+		}
+		check->cases += 1;
+		if (expected) check->hits += 1;
+		if (collide_AABB_vs_AABB(a_min, a_max, b_min, b_max) != expected) {
+			check->report(iteration, "expected " + std::to_string(expected));
+		} else if (collide_AABB_vs_AABB(b_min, b_max, a_min, a_max) != expected) {
+			check->report(iteration, "not symmetric");
+		}
+	}
+}
+
+void check_swept_sphere_vs_swept_sphere(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto point = [&](float scale) {
+		return scale * glm::vec3(unit(mt), unit(mt), unit(mt));
+	};
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		glm::vec3 from0 = point(3.0f), to0 = from0 + point(3.0f);
+		glm::vec3 from1 = point(3.0f), to1 = (mt() % 4 == 0 ? from1 : from1 + point(3.0f));
+		float radius0 = 0.1f + (unit(mt) + 1.0f);
+		float radius1 = 0.1f + 0.5f * (unit(mt) + 1.0f);
+		float limit = random_limit(mt);
+
+		//reference: the first time the centers are within the sum of the radii:
+		auto center0 = [&](float t) { return glm::mix(from0, to0, t); };
+		auto center1 = [&](float t) { return glm::mix(from1, to1, t); };
+		auto gap = [&](float t) { return glm::length(center0(t) - center1(t)) - (radius0 + radius1); };
+		float ref_t = 0.0f;
+		bool ambiguous;
+		float margin = 1.5f * glm::length((to0 - from0) - (to1 - from1)) * std::min(1.0f, limit) / ReferenceSteps + 1e-4f;
+		bool ref_hit = reference_first_contact(gap, std::min(1.0f, limit), margin, &ref_t, &ambiguous);
+
+		check->cases += 1;
+		if (ambiguous) {
+			check->skipped += 1;
+			continue;
+		}
+		if (ref_hit) check->hits += 1;
+
+		float t = limit;
+		glm::vec3 at = glm::vec3(1234.0f), out = glm::vec3(1234.0f);
+		bool hit = collide_swept_sphere_vs_swept_sphere(from0, to0, radius0, from1, to1, radius1, &t, &at, &out);
+		bool hit_no_outputs = collide_swept_sphere_vs_swept_sphere(from0, to0, radius0, from1, to1, radius1);
+
+		if (hit != ref_hit) {
+			check->report(iteration, "hit " + std::to_string(hit) + ", reference " + std::to_string(ref_hit));
+		} else if (limit >= 1.0f && hit_no_outputs != hit) {
+			check->report(iteration, "result changes without output pointers");
+		} else if (!hit) {
+			if (t != limit || at != glm::vec3(1234.0f) || out != glm::vec3(1234.0f)) check->report(iteration, "outputs written without a hit");
+		} else if (!close(t, ref_t)) {
+			check->report(iteration, "t " + std::to_string(t) + ", reference " + std::to_string(ref_t));
+		} else if (ref_t > 0.0f) {
+			glm::vec3 ref_out = glm::normalize(center0(ref_t) - center1(ref_t));
+			glm::vec3 ref_at = center0(ref_t) - radius0 * ref_out;
+			if (!close(out, ref_out)) check->report(iteration, "out (" + str(out) + "), reference (" + str(ref_out) + ")");
+			else if (!close(at, ref_at)) check->report(iteration, "at (" + str(at) + "), reference (" + str(ref_at) + ")");
+		}
+	}
+}
+
+void check_swept_sphere_vs_triangle(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		Scenario s = random_scenario(mt, 1);
+		glm::vec3 const &a = s.triangles[0], &b = s.triangles[1], &c = s.triangles[2];
+		float limit = random_limit(mt);
+
+		//reference: the first time the sphere's center comes within radius of the triangle...
+		auto center = [&](float t) { return glm::mix(s.from, s.to, t); };
+		auto gap = [&](float t) { return glm::length(center(t) - closest_point_on_triangle(center(t), a, b, c)) - s.radius; };
+		float ref_t = 0.0f;
+		bool ambiguous;
+		float margin = 1.5f * glm::length(s.to - s.from) * std::min(1.0f, limit) / ReferenceSteps + 1e-4f;
+		bool ref_hit = reference_first_contact(gap, std::min(1.0f, limit), margin, &ref_t, &ambiguous);
+		//...as long as it is moving toward the triangle's plane (spheres moving away pass through):
+		glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+		float dot_from = glm::dot(normal, s.from - a);
+		float dot_to = glm::dot(normal, s.to - a);
+		if (!((dot_from > 0.0f && dot_to < dot_from) || (dot_from < 0.0f && dot_to > dot_from))) ref_hit = false;
+
+		check->cases += 1;
+		if (ambiguous) {
+			check->skipped += 1;
+			continue;
+		}
+		if (ref_hit) check->hits += 1;
+
+		float t = limit;
+		glm::vec3 at = glm::vec3(1234.0f), out = glm::vec3(1234.0f);
+		bool hit = collide_swept_sphere_vs_triangle(s.from, s.to, s.radius, a, b, c, &t, &at, &out);
+		bool hit_no_outputs = collide_swept_sphere_vs_triangle(s.from, s.to, s.radius, a, b, c);
+
+		if (hit != ref_hit) {
+			check->report(iteration, "hit " + std::to_string(hit) + ", reference " + std::to_string(ref_hit));
+		} else if (limit >= 1.0f && hit_no_outputs != hit) {
+			check->report(iteration, "result changes without output pointers");
+		} else if (!hit) {
+			if (t != limit || at != glm::vec3(1234.0f) || out != glm::vec3(1234.0f)) check->report(iteration, "outputs written without a hit");
+		} else if (!close(t, ref_t)) {
+			check->report(iteration, "t " + std::to_string(t) + ", reference " + std::to_string(ref_t));
+		} else if (ref_t > 0.0f) {
+			glm::vec3 ref_at = closest_point_on_triangle(center(ref_t), a, b, c);
+			glm::vec3 ref_out = glm::normalize(center(ref_t) - ref_at);
+			if (!close(at, ref_at)) check->report(iteration, "at (" + str(at) + "), reference (" + str(ref_at) + ")");
+			else if (!close(out, ref_out)) check->report(iteration, "out (" + str(out) + "), reference (" + str(ref_out) + ")");
+		}
+	}
+}
+
+void check_batched_vs_scalar(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	PackedTriangles packed;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		//alternate single-triangle checks (which compare contact details) with batches:
+		Scenario s = random_scenario(mt, (iteration % 2 ? 1 : 23));
+
+		float start_t = (mt() % 4 == 0 ? 0.5f : 2.0f);
+
+		//reference: one triangle at a time:
+		float ref_t = start_t;
+		glm::vec3 ref_at, ref_out;
+		uint32_t ref_hit = -1U;
+		for (uint32_t i = 0; i < s.triangles.size(); i += 3) {
+			if (collide_swept_sphere_vs_triangle(s.from, s.to, s.radius, s.triangles[i], s.triangles[i+1], s.triangles[i+2], &ref_t, &ref_at, &ref_out)) {
+				ref_hit = i / 3;
+			}
+		}
+
+		packed.clear();
+		for (uint32_t i = 0; i < s.triangles.size(); i += 3) {
+			packed.push_back(s.triangles[i], s.triangles[i+1], s.triangles[i+2]);
+		}
+		float t = start_t;
+		glm::vec3 at, out;
+		uint32_t hit = collide_swept_sphere_vs_triangles(s.from, s.to, s.radius, packed, &t, &at, &out);
+
+		check->cases += 1;
+		if (ref_hit != -1U) check->hits += 1;
+
+		if ((hit == -1U) != (ref_hit == -1U)) {
+			check->report(iteration, "hit " + std::to_string(hit != -1U) + ", one at a time " + std::to_string(ref_hit != -1U));
+			continue;
+		}
+		if (hit == -1U) {
+			if (t != start_t) check->report(iteration, "collision_t changed without a hit");
+			continue;
+		}
+		if (!close(t, ref_t)) {
+			check->report(iteration, "t " + std::to_string(t) + ", one at a time " + std::to_string(ref_t));
+			continue;
+		}
+		//when several triangles are hit at (nearly) the same time, which one wins is down to rounding...
+		//...except that the first contact at t = 0 is never replaced:
+		if (hit != ref_hit) {
+			if (t == 0.0f && ref_t == 0.0f) check->report(iteration, "triangle " + std::to_string(hit) + " at t = 0, one at a time " + std::to_string(ref_hit));
+			continue;
+		}
+		if (!close(at, ref_at)) check->report(iteration, "collision_at mismatch");
+		else if (!close(out, ref_out)) check->report(iteration, "collision_out mismatch");
+	}
+}
+
+void check_parallel_vs_serial(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	PackedTriangles packed;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		//lots of triangles, split into small chunks (so there are lots of chunks):
+		Scenario s = random_scenario(mt, 2000);
+		packed.clear();
+		for (uint32_t i = 0; i < s.triangles.size(); i += 3) {
+			packed.push_back(s.triangles[i], s.triangles[i+1], s.triangles[i+2]);
+		}
+		uint32_t grain = 4 * (1 + mt() % 16);
+		float start_t = (mt() % 4 == 0 ? 0.5f : 2.0f);
+
+		float serial_t = start_t;
+		glm::vec3 serial_at = glm::vec3(0.0f), serial_out = glm::vec3(0.0f);
+		uint32_t serial_hit = collide_swept_sphere_vs_triangles(s.from, s.to, s.radius, packed, &serial_t, &serial_at, &serial_out);
+		float t = start_t;
+		glm::vec3 at = glm::vec3(0.0f), out = glm::vec3(0.0f);
+		uint32_t hit = collide_swept_sphere_vs_triangles_parallel(s.from, s.to, s.radius, packed, &t, &at, &out, grain);
+
+		check->cases += 1;
+		if (serial_hit != -1U) check->hits += 1;
+		//(should be exactly the same)
+		if (hit != serial_hit || t != serial_t || at != serial_at || out != serial_out) {
+			check->report(iteration, "triangle " + std::to_string(hit) + " at t " + std::to_string(t) + ", serial triangle " + std::to_string(serial_hit) + " at t " + std::to_string(serial_t));
+		}
+	}
+}
+
+void check_marked_meshes(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	PackedTriangles packed, marked;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		bool flat = (iteration % 2 == 0);
+		std::vector< glm::vec3 > triangles = random_heightfield(mt, flat);
+		std::vector< CollisionTriangle > records;
+		for (uint32_t i = 0; i < triangles.size(); i += 3) {
+			records.emplace_back(make_collision_triangle(triangles[i], triangles[i+1], triangles[i+2]));
+		}
+		packed.clear();
+		for (auto const &record : records) packed.push_back(record);
+		mark_convex_features(&records);
+		marked.clear();
+		for (auto const &record : records) marked.push_back(record);
+
+		//sweep from above the surface (which is the side features are judged from):
+		float radius = 0.1f + 0.4f * (unit(mt) + 1.0f);
+		glm::vec3 from = glm::vec3(1.5f * unit(mt), 1.5f * unit(mt), 0.5f + radius + 0.01f + unit(mt) + 1.0f);
+		glm::vec3 to = glm::vec3(1.5f * unit(mt), 1.5f * unit(mt), unit(mt));
+		if (flat) to.z = (mt() % 2 ? radius * 0.5f : 0.5f * unit(mt)); //(includes shallow sweeps that graze along the surface)
+
+		float all_t = 2.0f;
+		uint32_t all_hit = collide_swept_sphere_vs_triangles(from, to, radius, packed, &all_t);
+		float t = 2.0f;
+		glm::vec3 out;
+		uint32_t hit = collide_swept_sphere_vs_triangles(from, to, radius, marked, &t, nullptr, &out);
+
+		check->cases += 1;
+		if (all_hit != -1U) check->hits += 1;
+		if ((hit == -1U) != (all_hit == -1U)) {
+			check->report(iteration, std::string(flat ? "flat " : "") + "hit " + std::to_string(hit != -1U) + ", all features " + std::to_string(all_hit != -1U));
+		} else if (hit != -1U && !close(t, all_t)) {
+			check->report(iteration, std::string(flat ? "flat " : "") + "t " + std::to_string(t) + ", all features " + std::to_string(all_t));
+		} else if (hit != -1U && flat && !close(out, glm::vec3(0.0f, 0.0f, 1.0f))) {
+			check->report(iteration, "bump on flat mesh (collision_out " + str(out) + ")");
+		}
+	}
+}
+
+void check_swept_sphere_vs_box(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto point = [&](float scale) {
+		return scale * glm::vec3(unit(mt), unit(mt), unit(mt));
+	};
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		CollisionBox box = random_box(mt);
+		glm::vec3 from = point(3.0f);
+		glm::vec3 to = (mt() % 8 == 0 ? from + point(0.01f) : point(3.0f));
+		float radius = 0.05f + 0.5f * (unit(mt) + 1.0f);
+		float limit = random_limit(mt);
+
+		//reference: the first time the center comes within radius of the (solid) box...
+		auto center = [&](float t) { return glm::mix(from, to, t); };
+		auto gap = [&](float t) { return glm::length(center(t) - closest_point_on_box(center(t), box)) - radius; };
+		float ref_t = 0.0f;
+		bool ambiguous;
+		float margin = 1.5f * glm::length(to - from) * std::min(1.0f, limit) / ReferenceSteps + 1e-4f;
+		bool ref_hit = reference_first_contact(gap, std::min(1.0f, limit), margin, &ref_t, &ambiguous);
+		//...except spheres that start out touching only collide if moving further in:
+		if (ref_hit && ref_t == 0.0f) {
+			glm::vec3 on_box = closest_point_on_box(from, box);
+			float speed_out = glm::dot(to - from, from - on_box);
+			//(skip centers inside the box, and motion nearly along the surface)
+			bool inside = true;
+			for (uint32_t k = 0; k < 3; ++k) {
+				if (std::abs(glm::dot(from - box.center, box.axes[k])) > box.half_extents[k]) inside = false;
+			}
+			if (inside || std::abs(speed_out) < 1e-3f * glm::length(to - from) * glm::length(from - on_box)) ambiguous = true;
+			if (!(speed_out < 0.0f)) ref_hit = false;
+		}
+
+		check->cases += 1;
+		if (ambiguous) {
+			check->skipped += 1;
+			continue;
+		}
+		if (ref_hit) check->hits += 1;
+
+		float t = limit;
+		glm::vec3 at = glm::vec3(1234.0f), out = glm::vec3(1234.0f);
+		bool hit = collide_swept_sphere_vs_box(from, to, radius, box, &t, &at, &out);
+		bool hit_no_outputs = collide_swept_sphere_vs_box(from, to, radius, box);
+
+		if (hit != ref_hit) {
+			check->report(iteration, "hit " + std::to_string(hit) + ", reference " + std::to_string(ref_hit));
+		} else if (limit >= 1.0f && hit_no_outputs != hit) {
+			check->report(iteration, "result changes without output pointers");
+		} else if (!hit) {
+			if (t != limit || at != glm::vec3(1234.0f) || out != glm::vec3(1234.0f)) check->report(iteration, "outputs written without a hit");
+		} else if (!close(t, ref_t)) {
+			check->report(iteration, "t " + std::to_string(t) + ", reference " + std::to_string(ref_t));
+		} else {
+			glm::vec3 ref_at = closest_point_on_box(center(ref_t), box);
+			glm::vec3 ref_out = glm::normalize(center(ref_t) - ref_at);
+			if (!close(at, ref_at)) check->report(iteration, "at (" + str(at) + "), reference (" + str(ref_at) + ")");
+			else if (!close(out, ref_out)) check->report(iteration, "out (" + str(out) + "), reference (" + str(ref_out) + ")");
+		}
+	}
+}
+
+void check_box_meshes(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	PackedTriangles packed;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		//triangles_form_box should find axis-aligned boxes (and only boxes):
+		CollisionBox box = random_box(mt);
+		bool aligned = (box.axes[0] == glm::vec3(1.0f, 0.0f, 0.0f));
+		std::vector< glm::vec3 > triangles = box_triangles(mt, box);
+		uint32_t damage = mt() % 4; //0: intact, 1: a side flipped inside-out, 2: a corner moved, 3: a triangle doubled
+		if (damage == 1) std::swap(triangles[0], triangles[1]);
+		if (damage == 2) triangles[4] += glm::vec3(0.0f, 0.0f, 0.01f);
+		if (damage == 3) std::copy(triangles.begin(), triangles.begin() + 3, triangles.begin() + 3);
+		std::vector< uint32_t > indices(triangles.size());
+		for (uint32_t i = 0; i < indices.size(); ++i) indices[i] = i;
+		glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+		bool is_box = triangles_form_box(triangles, indices, 0, uint32_t(indices.size()), &min, &max);
+		check->cases += 1;
+		if (is_box != (aligned && damage == 0)) {
+			check->report(iteration, "triangles_form_box says " + std::to_string(is_box) + (aligned ? " (aligned" : " (rotated") + ", damage " + std::to_string(damage) + ")");
+			continue;
+		}
+		if (is_box && !(close(min, box.center - box.half_extents) && close(max, box.center + box.half_extents))) {
+			check->report(iteration, "triangles_form_box found the wrong bounds");
+			continue;
+		}
+		if (damage != 0) continue;
+
+		//the box should be hit when (and where) its triangles are hit, by spheres starting outside:
+		float radius = 0.05f + 0.5f * (unit(mt) + 1.0f);
+		glm::vec3 from = 3.0f * glm::vec3(unit(mt), unit(mt), unit(mt));
+		glm::vec3 to = 3.0f * glm::vec3(unit(mt), unit(mt), unit(mt));
+		if (glm::length(from - closest_point_on_box(from, box)) < radius + 1e-3f) continue;
+		packed.clear();
+		for (uint32_t i = 0; i < triangles.size(); i += 3) {
+			packed.push_back(triangles[i], triangles[i+1], triangles[i+2]);
+		}
+		float mesh_t = 1.0f;
+		glm::vec3 mesh_at, mesh_out;
+		uint32_t mesh_hit = collide_swept_sphere_vs_triangles(from, to, radius, packed, &mesh_t, &mesh_at, &mesh_out);
+		float t = 1.0f;
+		glm::vec3 at, out;
+		bool hit = collide_swept_sphere_vs_box(from, to, radius, box, &t, &at, &out);
+		if (hit) check->hits += 1;
+		if (hit != (mesh_hit != -1U)) {
+			check->report(iteration, "hit " + std::to_string(hit) + ", mesh " + std::to_string(mesh_hit != -1U));
+		} else if (hit && !close(t, mesh_t)) {
+			check->report(iteration, "t " + std::to_string(t) + ", mesh " + std::to_string(mesh_t));
+		} else if (hit && std::abs(glm::dot(out, glm::normalize(to - from))) > 0.05f && !close(out, mesh_out, Tolerance / std::min(1.0f, radius))) {
+			//(at is ambiguous when touching an edge side-on, but out is not -- except in grazing contacts, where it changes quickly with t)
+			//(out is the direction from the contact point to the sphere's center, so small spheres magnify contact point error)
+			check->report(iteration, "out (" + str(out) + "), mesh (" + str(mesh_out) + ")");
+		}
+	}
+}
+
+void check_collision_world(std::mt19937 &mt, uint32_t iterations, Check *check) {
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		//a few heightfields stacked on top of each other:
+		std::vector< glm::vec3 > positions;
+		std::vector< uint32_t > indices;
+		for (uint32_t layer = 0; layer < 3; ++layer) {
+			for (auto const &p : random_heightfield(mt, false)) {
+				indices.emplace_back(uint32_t(positions.size()));
+				positions.emplace_back(p + glm::vec3(0.0f, 0.0f, 1.5f * layer));
+			}
+		}
+		//...and some boxes among them:
+		std::vector< CollisionBox > boxes;
+		for (uint32_t b = 0; b < 20; ++b) {
+			boxes.emplace_back(random_box(mt));
+			boxes.back().center = glm::vec3(2.0f * unit(mt), 2.0f * unit(mt), 2.0f + 2.0f * unit(mt));
+			boxes.back().half_extents *= 0.3f;
+		}
+		CollisionWorld world;
+		world.build(positions, indices, boxes);
+		PackedTriangles everything;
+		for (auto const &triangle : world.triangles) everything.push_back(triangle);
+
+		std::vector< CollisionWorld::Sweep > sweeps(1000);
+		for (auto &sweep : sweeps) {
+			sweep.from = glm::vec3(2.5f * unit(mt), 2.5f * unit(mt), 2.0f + 3.0f * unit(mt));
+			sweep.to = sweep.from + glm::vec3(unit(mt), unit(mt), unit(mt));
+			sweep.radius = (mt() % 4 == 0 ? 0.0f : 0.1f + 0.2f * (unit(mt) + 1.0f));
+		}
+		std::vector< CollisionWorld::Hit > hits;
+		world.sweep(sweeps, &hits);
+
+		for (uint32_t q = 0; q < sweeps.size(); ++q) {
+			CollisionWorld::Sweep const &sweep = sweeps[q];
+			CollisionWorld::Hit single;
+			world.sweep(sweep, &single);
+			float all_t = 1.0f;
+			bool all_hit = (collide_swept_sphere_vs_triangles(sweep.from, sweep.to, sweep.radius, everything, &all_t) != -1U);
+			for (auto const &box : boxes) {
+				if (collide_swept_sphere_vs_box(sweep.from, sweep.to, sweep.radius, box, &all_t)) all_hit = true;
+			}
+			check->cases += 1;
+			if (all_hit) check->hits += 1;
+			uint32_t index = iteration * uint32_t(sweeps.size()) + q;
+			bool single_hit = (single.triangle != -1U || single.box != -1U);
+			if (hits[q].triangle != single.triangle || hits[q].box != single.box || hits[q].t != single.t) {
+				check->report(index, "batched and single queries differ");
+			} else if (single_hit != all_hit || !close(single.t, all_t)) {
+				check->report(index, "t " + std::to_string(single.t) + ", testing everything " + std::to_string(all_t));
+			}
+		}
+	}
+}
+
+//------------------------------------------------
+//Benchmarks:
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//call fn(i) for i in [0, count) repeatedly for about a quarter second, then report calls per second:
+template< typename F >
+void benchmark(std::string const &name, uint32_t count, F const &fn) {
+	uint64_t calls = 0;
+	uint32_t hits = 0; //(reported, so calls can't be optimized away)
+	auto before = Clock::now();
+	double elapsed = 0.0;
+	while (elapsed < 0.25) {
+		for (uint32_t i = 0; i < count; ++i) {
+			if (fn(i)) hits += 1;
+		}
+		calls += count;
+		elapsed = std::chrono::duration< double >(Clock::now() - before).count();
+	}
+	std::cout << "  " << std::left << std::setw(46) << name << std::right
+		<< std::fixed << std::setprecision(2) << std::setw(9) << (calls / elapsed) * 1e-6 << " M/sec"
+		<< std::setprecision(1) << "  (" << (100.0 * hits / calls) << "% hit)" << std::defaultfloat << std::endl;
+}
+
+void run_benchmarks(std::mt19937 &mt) {
+	constexpr uint32_t Count = 4096;
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	auto point = [&](float scale) {
+		return scale * glm::vec3(unit(mt), unit(mt), unit(mt));
+	};
+
+	std::vector< glm::vec3 > boxes(4 * Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		glm::vec3 a = point(3.0f), b = point(3.0f), c = point(3.0f), d = point(3.0f);
+		boxes[4*i+0] = glm::min(a, b); boxes[4*i+1] = glm::max(a, b);
+		boxes[4*i+2] = glm::min(c, d); boxes[4*i+3] = glm::max(c, d);
+	}
+	benchmark("collide_AABB_vs_AABB", Count, [&](uint32_t i) {
+		return collide_AABB_vs_AABB(boxes[4*i+0], boxes[4*i+1], boxes[4*i+2], boxes[4*i+3]);
+	});
+
+	std::vector< glm::vec3 > spheres(4 * Count);
+	for (auto &p : spheres) p = point(3.0f);
+	benchmark("collide_swept_sphere_vs_swept_sphere", Count, [&](uint32_t i) {
+		float t = 1.0f;
+		glm::vec3 at, out;
+		return collide_swept_sphere_vs_swept_sphere(spheres[4*i+0], spheres[4*i+1], 1.0f, spheres[4*i+2], spheres[4*i+3], 0.5f, &t, &at, &out);
+	});
+
+	//sweeps near groups of triangles:
+	constexpr uint32_t GroupSize = 16;
+	std::vector< Scenario > scenarios;
+	std::vector< PackedTriangles > packed;
+	while (scenarios.size() < Count / GroupSize) {
+		Scenario s = random_scenario(mt, GroupSize);
+		if (s.triangles.size() != 3 * GroupSize) continue;
+		packed.emplace_back();
+		for (uint32_t i = 0; i < s.triangles.size(); i += 3) {
+			packed.back().push_back(s.triangles[i], s.triangles[i+1], s.triangles[i+2]);
+		}
+		scenarios.emplace_back(s);
+	}
+	benchmark("collide_swept_sphere_vs_triangle", Count, [&](uint32_t i) {
+		Scenario const &s = scenarios[i / GroupSize];
+		uint32_t v = 3 * (i % GroupSize);
+		float t = 1.0f;
+		glm::vec3 at, out;
+		return collide_swept_sphere_vs_triangle(s.from, s.to, s.radius, s.triangles[v], s.triangles[v+1], s.triangles[v+2], &t, &at, &out);
+	});
+	benchmark("collide_swept_sphere_vs_triangles (16 tris)", Count / GroupSize, [&](uint32_t i) {
+		Scenario const &s = scenarios[i];
+		float t = 1.0f;
+		glm::vec3 at, out;
+		return collide_swept_sphere_vs_triangles(s.from, s.to, s.radius, packed[i], &t, &at, &out) != -1U;
+	});
+
+	//sweeps near boxes, as a box and as the box's twelve triangles:
+	std::vector< CollisionBox > obbs(Count);
+	std::vector< PackedTriangles > box_meshes(Count);
+	for (uint32_t i = 0; i < Count; ++i) {
+		obbs[i] = random_box(mt);
+		std::vector< glm::vec3 > triangles = box_triangles(mt, obbs[i]);
+		for (uint32_t v = 0; v < triangles.size(); v += 3) {
+			box_meshes[i].push_back(triangles[v], triangles[v+1], triangles[v+2]);
+		}
+	}
+	benchmark("collide_swept_sphere_vs_box", Count, [&](uint32_t i) {
+		float t = 1.0f;
+		glm::vec3 at, out;
+		return collide_swept_sphere_vs_box(spheres[4*i+0], spheres[4*i+1], 0.5f, obbs[i], &t, &at, &out);
+	});
+	benchmark("collide_swept_sphere_vs_triangles (box mesh)", Count, [&](uint32_t i) {
+		float t = 1.0f;
+		glm::vec3 at, out;
+		return collide_swept_sphere_vs_triangles(spheres[4*i+0], spheres[4*i+1], 0.5f, box_meshes[i], &t, &at, &out) != -1U;
+	});
+}
+
+//------------------------------------------------
+
+int main(int argc, char **argv) {
+	uint32_t iterations = 1000000;
+	uint32_t seed = 0xc011d3;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t./fuzz-collide [iterations] [seed]\n";
+		return 1;
+	}
+	if (argc > 1) iterations = uint32_t(std::stoul(argv[1]));
+	if (argc > 2) seed = uint32_t(std::stoul(argv[2]));
+
+	std::mt19937 mt(seed);
+
+	//(CollisionWorld queries use worker threads, as in the game)
+	Parallel::init();
+
+	std::vector< Check > checks;
+	auto run = [&](std::string const &name, uint32_t count, void (*fn)(std::mt19937 &, uint32_t, Check *)) {
+		checks.emplace_back(name);
+		fn(mt, count, &checks.back());
+	};
+	run("collide_AABB_vs_AABB vs reference", iterations, check_AABB_vs_AABB);
+	run("swept_sphere_vs_swept_sphere vs reference", iterations, check_swept_sphere_vs_swept_sphere);
+	run("swept_sphere_vs_triangle vs reference", std::max(1U, iterations / 10), check_swept_sphere_vs_triangle);
+	run("swept_sphere_vs_triangles vs one at a time", std::max(1U, iterations / 4), check_batched_vs_scalar);
+	run("swept_sphere_vs_triangles_parallel vs serial", std::max(1U, iterations / 400), check_parallel_vs_serial);
+	run("marked meshes vs all features", std::max(1U, iterations / 40), check_marked_meshes);
+	run("swept_sphere_vs_box vs reference", std::max(1U, iterations / 10), check_swept_sphere_vs_box);
+	run("boxes vs their triangles", std::max(1U, iterations / 10), check_box_meshes);
+	run("CollisionWorld vs everything", std::max(1U, iterations / 40000), check_collision_world);
+
+	Parallel::shutdown();
+
+	uint32_t mismatches = 0;
+	std::cout << "Checks (seed " << seed << "):" << std::endl;
+	for (auto const &check : checks) {
+		check.summary();
+		mismatches += check.mismatches;
+	}
+
+	std::cout << "Queries per second:" << std::endl;
+	run_benchmarks(mt);
+
+	return (mismatches == 0 ? 0 : 1);
+}
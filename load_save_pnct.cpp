@@ -0,0 +1,152 @@
+#include "load_save_pnct.hpp"
+#include "read_write_chunk.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+//layout of entries in the 'idx0' chunk:
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+void load_pnct(std::string const &filename, PnctFile *pnct_) {
+	assert(pnct_);
+	auto &pnct = *pnct_;
+
+	//(throws if the file can't be opened)
+	MappedFile file(filename);
+	size_t offset = 0;
+
+	//vertex and index data are copied straight out of the mapping (no zero-fill, no stream buffering):
+	ChunkSpan< PnctFile::Vertex > vertices;
+	read_chunk(file, &offset, "pnct", &vertices);
+	pnct.vertices.assign(vertices.begin(), vertices.end());
+
+	ChunkSpan< char > strings;
+	read_chunk(file, &offset, "str0", &strings);
+
+	ChunkSpan< IndexEntry > index;
+	read_chunk(file, &offset, "idx0", &index);
+
+	pnct.indices.clear();
+	if (offset != file.size) {
+		ChunkSpan< uint32_t > indices;
+		read_chunk(file, &offset, "ele0", &indices);
+		for (uint32_t i : indices) {
+			if (i >= pnct.vertices.size()) {
+				throw std::runtime_error("element chunk has out-of-range vertex index");
+			}
+		}
+		pnct.indices.assign(indices.begin(), indices.end());
+	}
+	//mesh ranges are in terms of indices, if there are any:
+	size_t range_size = (pnct.indices.empty() ? pnct.vertices.size() : pnct.indices.size());
+
+	pnct.meshes.clear();
+	pnct.meshes.reserve(index.size());
+	for (auto const &entry : index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= range_size)) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		pnct.meshes.emplace_back();
+		pnct.meshes.back().name = std::string(strings.begin() + entry.name_begin, strings.begin() + entry.name_end);
+		pnct.meshes.back().vertex_begin = entry.vertex_begin;
+		pnct.meshes.back().vertex_end = entry.vertex_end;
+	}
+
+	if (offset != file.size) {
+		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
+	}
+}
+
+void save_pnct(std::string const &filename, PnctFile const &pnct) {
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	index.reserve(pnct.meshes.size());
+	for (auto const &mesh : pnct.meshes) {
+		assert(mesh.vertex_begin <= mesh.vertex_end && mesh.vertex_end <= (pnct.indices.empty() ? pnct.vertices.size() : pnct.indices.size()));
+		IndexEntry entry;
+		entry.name_begin = uint32_t(strings.size());
+		strings.insert(strings.end(), mesh.name.begin(), mesh.name.end());
+		entry.name_end = uint32_t(strings.size());
+		entry.vertex_begin = mesh.vertex_begin;
+		entry.vertex_end = mesh.vertex_end;
+		index.emplace_back(entry);
+	}
+
+	//pad strings so that following chunks stay 4-byte aligned (and can be read in place from a mapping):
+	strings.resize((strings.size() + 3) & ~size_t(3), '\0');
+
+	std::ofstream file(filename, std::ios::binary);
+	write_chunk("pnct", pnct.vertices, &file);
+	write_chunk("str0", strings, &file);
+	write_chunk("idx0", index, &file);
+	if (!pnct.indices.empty()) {
+		write_chunk("ele0", pnct.indices, &file);
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write mesh file '" + filename + "'.");
+	}
+}
+
+void index_pnct(PnctFile *pnct_) {
+	assert(pnct_);
+	auto &pnct = *pnct_;
+	if (!pnct.indices.empty() || pnct.vertices.empty()) return;
+
+	//hash vertices by their bytes, so only exact duplicates are merged:
+	typedef PnctFile::Vertex Vertex;
+	struct VertexHash {
+		size_t operator()(Vertex const &v) const {
+			//FNV-1a:
+			uint64_t hash = 0xcbf29ce484222325ULL;
+			unsigned char const *bytes = reinterpret_cast< unsigned char const * >(&v);
+			for (size_t i = 0; i < sizeof(Vertex); ++i) {
+				hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+			}
+			return size_t(hash);
+		}
+	};
+	struct VertexEqual {
+		bool operator()(Vertex const &a, Vertex const &b) const {
+			return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+
+	std::vector< Vertex > vertices;
+	std::unordered_map< Vertex, uint32_t, VertexHash, VertexEqual > lookup;
+	lookup.reserve(pnct.vertices.size());
+	pnct.indices.reserve(pnct.vertices.size());
+	for (auto const &v : pnct.vertices) {
+		auto ret = lookup.emplace(v, uint32_t(vertices.size()));
+		if (ret.second) vertices.emplace_back(v);
+		pnct.indices.emplace_back(ret.first->second);
+	}
+	//(mesh ranges were vertex ranges and are now the same index ranges)
+	pnct.vertices = std::move(vertices);
+}
+
+bool is_collider_name(std::string const &name, std::string *base) {
+	static std::string const suffix = ".Collider";
+	if (!(name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)) return false;
+	if (base) *base = name.substr(0, name.size() - suffix.size());
+	return true;
+}
+
+bool is_lod_name(std::string const &name, std::string *base, uint32_t *level) {
+	std::string::size_type dot = name.rfind(".LOD");
+	if (dot == std::string::npos || dot == 0 || dot + 4 == name.size()) return false;
+	if (name.find_first_not_of("0123456789", dot + 4) != std::string::npos) return false;
+	if (base) *base = name.substr(0, dot);
+	if (level) *level = uint32_t(std::stoul(name.substr(dot + 4)));
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+ * Load and save '.pnct' mesh files (as written by scenes/export-meshes.py).
+ *
+ * This doesn't touch OpenGL, so it is useful for offline tools as well as
+ * for MeshBuffer (which uploads the loaded data).
+ */
+
+struct PnctFile {
+	//vertex data, exactly as stored in the 'pnct' chunk:
+	struct Vertex {
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+	std::vector< Vertex > vertices;
+
+	//(optional) triangle vertex indices, from an 'ele0' chunk after the others:
+	// when present, mesh ranges below are ranges of this array rather than of 'vertices'.
+	std::vector< uint32_t > indices;
+
+	//named vertex (or index) ranges, from the 'str0' + 'idx0' chunks:
+	struct Mesh {
+		std::string name;
+		uint32_t vertex_begin = 0;
+		uint32_t vertex_end = 0;
+	};
+	std::vector< Mesh > meshes;
+};
+
+//NOTE: load_pnct will throw on error
+void load_pnct(std::string const &filename, PnctFile *pnct);
+void save_pnct(std::string const &filename, PnctFile const &pnct);
+
+//convert a non-indexed pnct to an indexed one by merging identical vertices:
+// (mesh ranges become index ranges; does nothing if 'pnct' already has indices)
+void index_pnct(PnctFile *pnct);
+
+//mesh naming conventions (shared by MeshBuffer and the tools that make these meshes):
+// "<name>.Collider" is a simplified collision stand-in for "<name>" (see simplify-colliders.cpp);
+// "<name>.LOD<n>" (with n all digits) is a lower level of detail of "<name>".
+// these return 'true' (and, if asked, "<name>" and n) for names that follow them:
+bool is_collider_name(std::string const &name, std::string *base = nullptr);
+bool is_lod_name(std::string const &name, std::string *base = nullptr, uint32_t *level = nullptr);
@@ -10,6 +10,15 @@
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//for per-pass timing (enabled with '--profile'):
+#include "FrameProfiler.hpp"
+
+//for reading resources on worker threads and streaming them to the GPU:
+#include "UploadQueue.hpp"
+
+//worker threads for parallel loops:
+#include "Parallel.hpp"
+
 //Sound subsystem:
 #include "Sound.hpp"
 
@@ -25,6 +34,8 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <vector>
+#include <string>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -32,6 +43,16 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+
+	//'--profile' may appear anywhere; everything else is positional:
+	bool profile = false;
+	std::vector< std::string > args;
+	for (int i = 1; i < argc; ++i) {
+		if (std::string(argv[i]) == "--profile") profile = true;
+		else args.emplace_back(argv[i]);
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -95,15 +116,42 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
+	//worker threads for batched work (e.g., CollisionWorld queries):
+	Parallel::init();
+
 	//------------ load resources --------------
-	call_load_functions();
+	//(MeshBuffers and SpriteAtlases read their files on UploadQueue worker threads)
+	UploadQueue::init();
+
+	//finish streaming resources to the GPU a few milliseconds per frame, so the window stays responsive:
+	bool quit_while_loading = false;
+	auto pump_while_loading = [&]() {
+		while (UploadQueue::busy() && !quit_while_loading) {
+			SDL_Event evt;
+			while (SDL_PollEvent(&evt) == 1) {
+				if (evt.type == SDL_QUIT) quit_while_loading = true;
+			}
+			UploadQueue::pump(4.0);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			SDL_GL_SwapWindow(window);
+		}
+	};
+
+	//start reading files (all at once), and pump until they are read:
+	call_load_functions(LoadTagDefault);
+	pump_while_loading();
+
+	//then look things up in them:
+	call_load_functions(LoadTagLate);
+	pump_while_loading();
 
 	//------------ create game mode + make current --------------
-	if (argc > 1) {
+	if (!args.empty()) {
 		int32_t level = -1;
-		if (argc >= 2) level = std::stoi(argv[1]);
-		if (argc != 2 || level < 0 || level >= int32_t(bubble_levels->size())) {
-			std::cerr << "Usage:\n\t" << argv[0] << " [level number]" << std::endl;
+		level = std::stoi(args[0]);
+		if (args.size() != 1 || level < 0 || level >= int32_t(bubble_levels->size())) {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--profile] [level number]" << std::endl;
 		}
 		auto level_iter = bubble_levels->begin();
 		for (int32_t i = 0; i < level; ++i) {
@@ -113,8 +161,11 @@ int main(int argc, char **argv) {
 	} else {
 		Mode::set_current(std::make_shared< BubbleMode >(bubble_levels->front()));
 	}
+	if (quit_while_loading) Mode::set_current(nullptr);
 
 	//------------ main loop ------------
+	if (profile) FrameProfiler::init();
+
   SDL_SetRelativeMouseMode(SDL_TRUE);
 
 	//this inline function will be called whenever the window is resized,
@@ -136,8 +187,10 @@ int main(int argc, char **argv) {
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
+		FrameProfiler::begin_frame();
 
 		{ //(1) process any events that are pending
+			FrameProfiler::Scope profile_events("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -169,7 +222,13 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
+		{ //resources loaded after startup are streamed to the GPU a bit at a time:
+			FrameProfiler::Scope profile_upload("upload");
+			UploadQueue::pump(2.0);
+		}
+
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
+			FrameProfiler::Scope profile_update("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -184,17 +243,29 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
+			FrameProfiler::Scope profile_draw("draw");
 
 			Mode::current->draw(drawable_size);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			FrameProfiler::Scope profile_swap("swap");
+			SDL_GL_SwapWindow(window);
+		}
+
+		FrameProfiler::end_frame();
 	}
 
 
 	//------------  teardown ------------
 
+	//(prints a summary if profiling was enabled)
+	FrameProfiler::shutdown();
+
+	UploadQueue::shutdown();
+
+	Parallel::shutdown();
+
 	Sound::shutdown();
 
 	SDL_GL_DeleteContext(context);
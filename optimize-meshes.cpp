@@ -0,0 +1,331 @@
+#include "load_save_pnct.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <cassert>
+
+/*
+ * optimize the triangle order of the meshes in a '.pnct' file:
+ *  - for the post-transform vertex cache, using Forsyth's "Linear-Speed Vertex Cache Optimisation"
+ *  - then for overdraw, by splitting that order into clusters and sorting the clusters
+ *    outward-facing first (as in Sander, Nehab, and Barczak's "Fast Triangle Reordering")
+ *  - and finally renumbering vertices in order of first use, for vertex fetch locality
+ * The output is an indexed '.pnct' (with an 'ele0' chunk) that MeshBuffer loads directly.
+ */
+
+//size of the simulated FIFO cache used to report ACMR/ATVR:
+constexpr uint32_t ReportCacheSize = 16;
+//size of the LRU cache that Forsyth's scoring models:
+constexpr uint32_t ForsythCacheSize = 32;
+//clusters are cut wherever the cache-optimized order's running ACMR drops below this:
+constexpr float ClusterACMRThreshold = 0.75f;
+
+//FIFO cache simulation over a range of triangle indices:
+struct CacheStats {
+	uint32_t misses = 0;
+	uint32_t triangles = 0;
+	uint32_t vertices = 0; //unique vertices referenced
+	float acmr() const { return triangles ? float(misses) / float(triangles) : 0.0f; }
+	float atvr() const { return vertices ? float(misses) / float(vertices) : 0.0f; }
+};
+
+CacheStats simulate_fifo(uint32_t const *indices, uint32_t count, uint32_t vertex_count) {
+	CacheStats stats;
+	stats.triangles = count / 3;
+	std::vector< uint32_t > entered(vertex_count, 0); //time vertex entered the cache (+1), 0 == never
+	std::vector< bool > used(vertex_count, false);
+	uint32_t time = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t v = indices[i];
+		if (!used[v]) {
+			used[v] = true;
+			stats.vertices += 1;
+		}
+		//in a FIFO cache, a vertex is resident if fewer than ReportCacheSize misses have happened since it entered:
+		if (entered[v] == 0 || time - (entered[v] - 1) > ReportCacheSize) {
+			stats.misses += 1;
+			entered[v] = time + 1;
+			time += 1;
+		}
+	}
+	return stats;
+}
+
+//Forsyth's vertex scoring:
+float forsyth_score(int32_t cache_position, uint32_t remaining_valence) {
+	if (remaining_valence == 0) return -1.0f; //no triangles need this vertex
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		if (cache_position < 3) {
+			//vertices of the last triangle get a fixed score, so no preference for any direction:
+			score = 0.75f;
+		} else {
+			float scaler = 1.0f / float(ForsythCacheSize - 3);
+			score = std::pow(1.0f - float(cache_position - 3) * scaler, 1.5f);
+		}
+	}
+	//boost vertices with few triangles left, to avoid leaving lone triangles behind:
+	score += 2.0f * std::pow(float(remaining_valence), -0.5f);
+	return score;
+}
+
+//reorder the triangles in indices[0,count) for the vertex cache:
+void optimize_forsyth(uint32_t *indices, uint32_t count, uint32_t vertex_count) {
+	uint32_t triangle_count = count / 3;
+	if (triangle_count == 0) return;
+
+	//vertex -> triangles adjacency:
+	std::vector< uint32_t > adjacency_begin(vertex_count + 1, 0);
+	for (uint32_t i = 0; i < count; ++i) adjacency_begin[indices[i] + 1] += 1;
+	for (uint32_t v = 0; v < vertex_count; ++v) adjacency_begin[v + 1] += adjacency_begin[v];
+	std::vector< uint32_t > adjacency(count);
+	{
+		std::vector< uint32_t > fill(adjacency_begin.begin(), adjacency_begin.end() - 1);
+		for (uint32_t i = 0; i < count; ++i) adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector< uint32_t > remaining(vertex_count, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v) remaining[v] = adjacency_begin[v + 1] - adjacency_begin[v];
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > vertex_score(vertex_count, 0.0f);
+	for (uint32_t v = 0; v < vertex_count; ++v) vertex_score[v] = forsyth_score(-1, remaining[v]);
+
+	std::vector< float > triangle_score(triangle_count, 0.0f);
+	std::vector< bool > emitted(triangle_count, false);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		triangle_score[t] = vertex_score[indices[3*t+0]] + vertex_score[indices[3*t+1]] + vertex_score[indices[3*t+2]];
+	}
+
+	std::vector< uint32_t > output;
+	output.reserve(count);
+	std::vector< uint32_t > cache; //most recent first
+	uint32_t scan = 0; //for finding the next unemitted triangle when the cache has nothing useful
+
+	uint32_t best = -1U;
+	float best_score = -std::numeric_limits< float >::infinity();
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		if (triangle_score[t] > best_score) {
+			best_score = triangle_score[t];
+			best = t;
+		}
+	}
+
+	while (best != -1U) {
+		emitted[best] = true;
+		uint32_t const *tri = indices + 3 * best;
+		output.insert(output.end(), tri, tri + 3);
+
+		//move triangle's vertices to the front of the cache:
+		std::vector< uint32_t > new_cache(tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) new_cache.emplace_back(v);
+		}
+		for (uint32_t i = 0; i < 3; ++i) {
+			remaining[tri[i]] -= 1;
+		}
+
+		//update positions and scores of everything that was in (or fell out of) the cache:
+		for (uint32_t i = 0; i < new_cache.size(); ++i) {
+			uint32_t v = new_cache[i];
+			cache_position[v] = (i < ForsythCacheSize ? int32_t(i) : -1);
+			vertex_score[v] = forsyth_score(cache_position[v], remaining[v]);
+		}
+		if (new_cache.size() > ForsythCacheSize) new_cache.resize(ForsythCacheSize);
+		cache.swap(new_cache);
+
+		//rescore triangles touching the cache, and pick the best:
+		best = -1U;
+		best_score = -std::numeric_limits< float >::infinity();
+		for (uint32_t v : cache) {
+			for (uint32_t a = adjacency_begin[v]; a < adjacency_begin[v+1]; ++a) {
+				uint32_t t = adjacency[a];
+				if (emitted[t]) continue;
+				triangle_score[t] = vertex_score[indices[3*t+0]] + vertex_score[indices[3*t+1]] + vertex_score[indices[3*t+2]];
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+		//nothing adjacent to the cache: take the next triangle not yet emitted:
+		if (best == -1U) {
+			while (scan < triangle_count && emitted[scan]) ++scan;
+			if (scan < triangle_count) best = scan;
+		}
+	}
+
+	assert(output.size() == triangle_count * 3);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+//cut the cache-optimized order into clusters and sort them outward-facing first, to reduce overdraw:
+void optimize_overdraw(uint32_t *indices, uint32_t count, std::vector< glm::vec3 > const &positions) {
+	uint32_t triangle_count = count / 3;
+	if (triangle_count < 2) return;
+
+	//cluster boundaries are placed where the cache has settled into a good run (which keeps the cache cost low):
+	std::vector< uint32_t > cluster_begin(1, 0);
+	{
+		std::vector< uint32_t > entered(positions.size(), 0);
+		uint32_t time = 0;
+		uint32_t misses = 0;
+		uint32_t triangles = 0;
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			for (uint32_t i = 0; i < 3; ++i) {
+				uint32_t v = indices[3*t+i];
+				if (entered[v] == 0 || time - (entered[v] - 1) > ReportCacheSize) {
+					misses += 1;
+					entered[v] = time + 1;
+					time += 1;
+				}
+			}
+			triangles += 1;
+			if (float(misses) / float(triangles) < ClusterACMRThreshold && t + 1 < triangle_count) {
+				cluster_begin.emplace_back(t + 1);
+				misses = 0;
+				triangles = 0;
+			}
+		}
+	}
+	cluster_begin.emplace_back(triangle_count);
+	uint32_t cluster_count = uint32_t(cluster_begin.size()) - 1;
+	if (cluster_count < 2) return;
+
+	//area-weighted mesh centroid:
+	glm::vec3 mesh_centroid = glm::vec3(0.0f);
+	float mesh_area = 0.0f;
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		glm::vec3 const &a = positions[indices[3*t+0]];
+		glm::vec3 const &b = positions[indices[3*t+1]];
+		glm::vec3 const &c = positions[indices[3*t+2]];
+		float area = glm::length(glm::cross(b-a, c-a));
+		mesh_centroid += area * (a + b + c) / 3.0f;
+		mesh_area += area;
+	}
+	if (mesh_area > 0.0f) mesh_centroid /= mesh_area;
+
+	//clusters that face away from the centroid are more likely to occlude others, so draw them first:
+	std::vector< float > sort_key(cluster_count, 0.0f);
+	for (uint32_t c = 0; c < cluster_count; ++c) {
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = cluster_begin[c]; t < cluster_begin[c+1]; ++t) {
+			glm::vec3 const &a = positions[indices[3*t+0]];
+			glm::vec3 const &b = positions[indices[3*t+1]];
+			glm::vec3 const &c2 = positions[indices[3*t+2]];
+			glm::vec3 n = glm::cross(b-a, c2-a); //length is twice the area
+			centroid += glm::length(n) * (a + b + c2) / 3.0f;
+			normal += n;
+			area += glm::length(n);
+		}
+		if (area > 0.0f) centroid /= area;
+		float normal_length = glm::length(normal);
+		if (normal_length > 0.0f) normal /= normal_length;
+		sort_key[c] = glm::dot(centroid - mesh_centroid, normal);
+	}
+
+	std::vector< uint32_t > order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+		return sort_key[a] > sort_key[b];
+	});
+
+	std::vector< uint32_t > output;
+	output.reserve(count);
+	for (uint32_t c : order) {
+		output.insert(output.end(), indices + 3 * cluster_begin[c], indices + 3 * cluster_begin[c+1]);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try { //windows doesn't print nice errors for unhandled exceptions, so we need to.
+#endif
+	if (argc != 3) {
+		std::cerr << "Usage:\n\t./optimize-meshes <in.pnct> <out.pnct>\n";
+		std::cerr << " will reorder the triangles of each mesh in \"in.pnct\" for the vertex cache and overdraw and write the result to \"out.pnct\".\n";
+		std::cerr.flush();
+		return 1;
+	}
+	std::string in_file = argv[1];
+	std::string out_file = argv[2];
+
+	PnctFile pnct;
+	load_pnct(in_file, &pnct);
+	index_pnct(&pnct);
+
+	std::vector< glm::vec3 > positions;
+	positions.reserve(pnct.vertices.size());
+	for (auto const &v : pnct.vertices) {
+		positions.emplace_back(v.Position);
+	}
+	uint32_t vertex_count = uint32_t(pnct.vertices.size());
+
+	std::cout << "Optimizing '" << in_file << "' (ACMR/ATVR with a " << ReportCacheSize << "-entry FIFO cache):\n";
+	std::cout << std::fixed << std::setprecision(3);
+	CacheStats total_before, total_after;
+	for (auto const &mesh : pnct.meshes) {
+		uint32_t *indices = pnct.indices.data() + mesh.vertex_begin;
+		uint32_t count = mesh.vertex_end - mesh.vertex_begin;
+		if (count % 3 != 0) {
+			std::cerr << "WARNING: mesh '" << mesh.name << "' isn't a list of triangles; leaving it as-is." << std::endl;
+			continue;
+		}
+
+		CacheStats before = simulate_fifo(indices, count, vertex_count);
+		optimize_forsyth(indices, count, vertex_count);
+		optimize_overdraw(indices, count, positions);
+		CacheStats after = simulate_fifo(indices, count, vertex_count);
+
+		std::cout << "  " << std::left << std::setw(24) << mesh.name << std::right
+			<< " ACMR " << before.acmr() << " -> " << after.acmr()
+			<< "   ATVR " << before.atvr() << " -> " << after.atvr()
+			<< "   (" << after.triangles << " triangles, " << after.vertices << " vertices)\n";
+
+		total_before.misses += before.misses; total_before.triangles += before.triangles; total_before.vertices += before.vertices;
+		total_after.misses += after.misses; total_after.triangles += after.triangles; total_after.vertices += after.vertices;
+	}
+	std::cout << "  " << std::left << std::setw(24) << "(all)" << std::right
+		<< " ACMR " << total_before.acmr() << " -> " << total_after.acmr()
+		<< "   ATVR " << total_before.atvr() << " -> " << total_after.atvr() << "\n";
+	std::cout << std::defaultfloat;
+
+	//renumber vertices in order of first use, so vertex fetches walk forward through the buffer:
+	{
+		std::vector< uint32_t > remap(vertex_count, -1U);
+		std::vector< PnctFile::Vertex > vertices;
+		vertices.reserve(vertex_count);
+		for (auto &i : pnct.indices) {
+			if (remap[i] == -1U) {
+				remap[i] = uint32_t(vertices.size());
+				vertices.emplace_back(pnct.vertices[i]);
+			}
+			i = remap[i];
+		}
+		pnct.vertices = std::move(vertices);
+	}
+
+	save_pnct(out_file, pnct);
+	std::cout << "Wrote '" << out_file << "': " << pnct.vertices.size() << " vertices, " << pnct.indices.size() << " indices, " << pnct.meshes.size() << " meshes." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
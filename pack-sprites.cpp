@@ -364,6 +364,9 @@ int main(int argc, char **argv) {
 			);
 		}
 
+		//pad strings so that the sprite chunk stays 4-byte aligned (and can be read in place from a mapping):
+		strings.resize((strings.size() + 3) & ~size_t(3), '\0');
+
 		std::ofstream out(outname + ".atlas", std::ios::binary);
 		write_chunk("str0", strings, &out);
 		write_chunk("spr0", datas, &out);
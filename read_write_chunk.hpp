@@ -1,8 +1,13 @@
 #pragma once
 
+#include "MappedFile.hpp"
+
 #include <iostream>
 #include <vector>
 #include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
 
 //helper function that reads an array of structures preceded by a simple header:
@@ -41,6 +46,74 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 }
 
 
+//read-only, typed view of a chunk's contents; points directly into a MappedFile when possible:
+// (the MappedFile must outlive the span)
+template< typename T >
+struct ChunkSpan {
+	T const *begin() const { return data_; }
+	T const *end() const { return data_ + size_; }
+	T const *data() const { return data_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	T const &operator[](size_t i) const { assert(i < size_); return data_[i]; }
+
+	T const *data_ = nullptr;
+	size_t size_ = 0;
+	//chunks that aren't aligned for T in the file are copied here instead:
+	std::vector< T > storage;
+
+	ChunkSpan() = default;
+	//(moving keeps 'storage's allocation, so data_ stays valid; copying wouldn't)
+	ChunkSpan(ChunkSpan &&) = default;
+	ChunkSpan &operator=(ChunkSpan &&) = default;
+	ChunkSpan(ChunkSpan const &) = delete;
+	ChunkSpan &operator=(ChunkSpan const &) = delete;
+};
+
+//helper function that reads a chunk (in the same format as above) from a mapped file without copying:
+// reads the chunk starting at *offset and advances *offset past it.
+template< typename T >
+void read_chunk(MappedFile const &from, size_t *offset_, std::string const &magic, ChunkSpan< T > *to_) {
+	static_assert(std::is_trivially_copyable< T >::value, "chunk elements must be plain data");
+	assert(magic.size() == 4);
+	assert(offset_);
+	assert(to_);
+	auto &offset = *offset_;
+	auto &to = *to_;
+
+	if (offset > from.size || from.size - offset < 8) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	char const *header = from.data + offset;
+	if (std::string(header, 4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	uint32_t size = 0;
+	std::memcpy(&size, header + 4, sizeof(size));
+	offset += 8;
+
+	if (size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (from.size - offset < size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+
+	char const *bytes = from.data + offset;
+	to.size_ = size / sizeof(T);
+	if (reinterpret_cast< uintptr_t >(bytes) % alignof(T) == 0) {
+		to.storage.clear();
+		to.data_ = reinterpret_cast< T const * >(bytes);
+	} else {
+		//unaligned (e.g., following a string chunk whose length isn't a multiple of four):
+		to.storage.resize(to.size_);
+		if (size) std::memcpy(to.storage.data(), bytes, size);
+		to.data_ = to.storage.data();
+	}
+	offset += size;
+}
+
+
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
 void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_) {
@@ -159,6 +159,9 @@ for obj in bpy.data.objects:
 #check that code created as much data as anticipated:
 assert(vertex_count * (4*3+4*3+4*1+4*2) == len(data))
 
+#pad strings so that the index chunk stays 4-byte aligned for in-place reading:
+strings += b'\0' * (-len(strings) % 4)
+
 #write the data chunk and index chunk to an output blob:
 blob = open(outfile, 'wb')
 #first chunk: the data
@@ -189,6 +189,9 @@ def write_chunk(magic, data):
 	blob.write(struct.pack('I', len(data))) #length
 	blob.write(data)
 
+#(strings are padded so that the following chunks stay 4-byte aligned for in-place reading)
+strings_data += b'\0' * (-len(strings_data) % 4)
+
 write_chunk(b'str0', strings_data)
 write_chunk(b'xfh0', xfh_data)
 write_chunk(b'msh0', mesh_data)
@@ -120,6 +120,8 @@ int main(int argc, char **argv) {
 				drawable.pipeline.type = mesh.type;
 				drawable.pipeline.start = mesh.start;
 				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.index_type = mesh.index_type;
+				drawable.pipeline.position_to_object = mesh.position_to_object;
 
 			});
 		} catch (std::exception &e) {
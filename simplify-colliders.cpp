@@ -0,0 +1,677 @@
+#include "load_save_pnct.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <array>
+#include <map>
+#include <set>
+#include <queue>
+#include <tuple>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+
+/*
+ * generate simplified collision meshes for the meshes in a '.pnct' file:
+ *  - each mesh "<name>" gets a "<name>.Collider" mesh
+ *  - meshes whose bounding box is within the error bound of their surface (e.g., bevelled blocks)
+ *    get that box, which StaticCollision tests as a single oriented box
+ *  - other meshes are simplified by collapsing edges in order of
+ *    quadric error (Garland and Heckbert's "Surface Simplification Using Quadric Error Metrics")
+ *  - collapses stop once the next one would move a vertex further than the error bound from
+ *    any of the original planes around it (boundary edges are held in place by extra planes)
+ *  - collapses that would flip a triangle or make the surface non-manifold are skipped
+ * MeshBuffer keeps the triangles of "<name>.Collider" meshes and attaches them to "<name>" (see Mesh::collider).
+ * Existing ".Collider" meshes are replaced, so the tool can be re-run on its own output.
+ *
+ * with '--lods', makes levels of detail instead:
+ *  - each mesh "<name>" gets "<name>.LOD1", "<name>.LOD2", ... simplified (the same way, but without an
+ *    error bound) to the given fractions of its triangles
+ *  - a level is skipped if it would not save at least a quarter of the previous level's triangles
+ *  - colors and texture coordinates are averaged over collapsed vertices; normals too, where the
+ *    original was smooth-shaded (flat-shaded originals get flat-shaded levels)
+ * MeshBuffer attaches "<name>.LOD<n>" meshes to "<name>" (see Mesh::lods); existing ones are replaced.
+ */
+
+//default error bound (in mesh units):
+constexpr float DefaultMaxError = 0.1f;
+//box faces are checked against the mesh at this many points along each side:
+constexpr uint32_t BoxSamples = 5;
+//weight of the planes that keep boundary edges in place, relative to surface planes:
+constexpr double BoundaryWeight = 10.0;
+//collapses that turn a triangle more than this far (cosine of the angle) away from its old normal are skipped:
+constexpr double MinNormalDot = 0.2;
+//levels of detail must have at most this fraction of the previous level's triangles:
+constexpr float MaxLODFraction = 0.75f;
+
+//symmetric 4x4 quadric, stored as its upper triangle:
+struct Quadric {
+	double a[10] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	//squared distance to plane dot(n,x) + d == 0 (with unit n), times weight:
+	static Quadric plane(glm::dvec3 const &n, double d, double weight) {
+		Quadric q;
+		q.a[0] = n.x*n.x; q.a[1] = n.x*n.y; q.a[2] = n.x*n.z; q.a[3] = n.x*d;
+		                  q.a[4] = n.y*n.y; q.a[5] = n.y*n.z; q.a[6] = n.y*d;
+		                                    q.a[7] = n.z*n.z; q.a[8] = n.z*d;
+		                                                      q.a[9] = d*d;
+		for (auto &v : q.a) v *= weight;
+		return q;
+	}
+	Quadric &operator+=(Quadric const &o) {
+		for (uint32_t i = 0; i < 10; ++i) a[i] += o.a[i];
+		return *this;
+	}
+	double error(glm::dvec3 const &p) const {
+		return a[0]*p.x*p.x + 2.0*a[1]*p.x*p.y + 2.0*a[2]*p.x*p.z + 2.0*a[3]*p.x
+		     + a[4]*p.y*p.y + 2.0*a[5]*p.y*p.z + 2.0*a[6]*p.y
+		     + a[7]*p.z*p.z + 2.0*a[8]*p.z
+		     + a[9];
+	}
+	//point with least error, if the quadric isn't (nearly) singular:
+	bool minimizer(glm::dvec3 *p) const {
+		//solve A p = -b (A symmetric) with Cramer's rule:
+		glm::dvec3 c0(a[0], a[1], a[2]), c1(a[1], a[4], a[5]), c2(a[2], a[5], a[7]);
+		glm::dvec3 rhs(-a[3], -a[6], -a[8]);
+		double det = glm::dot(c0, glm::cross(c1, c2));
+		if (std::abs(det) < 1e-12) return false;
+		*p = glm::dvec3(
+			glm::dot(rhs, glm::cross(c1, c2)),
+			glm::dot(c0, glm::cross(rhs, c2)),
+			glm::dot(c0, glm::cross(c1, rhs))
+		) / det;
+		return true;
+	}
+};
+
+//closest point to p on triangle abc (from Ericson's "Real-Time Collision Detection", 5.1.5):
+glm::vec3 closest_point_on_triangle(glm::vec3 const &p, glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+	float vc = d1*d4 - d3*d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + (d1 / (d1 - d3)) * ab;
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+	float vb = d5*d2 - d1*d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + (d2 / (d2 - d6)) * ac;
+	float va = d3*d6 - d5*d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+//check if the bounding box of the triangles is a good enough stand-in for them:
+// (every vertex is near a side of the box, and every sample point on the box's sides is near a triangle)
+// returns 'true' and writes the box's triangles (outward-facing, two per side) if so.
+bool fit_box(std::vector< glm::vec3 > const &positions, std::vector< uint32_t > const &indices, float max_error, std::vector< glm::vec3 > *box_positions, std::vector< uint32_t > *box_indices, float *worst_error) {
+	if (indices.empty()) return false;
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (uint32_t i : indices) {
+		min = glm::min(min, positions[i]);
+		max = glm::max(max, positions[i]);
+	}
+	for (uint32_t c = 0; c < 3; ++c) {
+		if (!(max[c] > min[c])) return false; //flat meshes aren't boxes
+	}
+
+	float worst = 0.0f;
+	for (uint32_t i : indices) {
+		glm::vec3 const &p = positions[i];
+		float to_side = std::numeric_limits< float >::infinity();
+		for (uint32_t c = 0; c < 3; ++c) {
+			to_side = std::min(to_side, std::min(p[c] - min[c], max[c] - p[c]));
+		}
+		if (to_side > max_error) return false;
+		worst = std::max(worst, to_side);
+	}
+
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		uint32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
+		for (uint32_t side = 0; side < 2; ++side) {
+			for (uint32_t su = 0; su < BoxSamples; ++su) {
+				for (uint32_t sv = 0; sv < BoxSamples; ++sv) {
+					glm::vec3 p;
+					p[axis] = (side ? max[axis] : min[axis]);
+					p[u] = glm::mix(min[u], max[u], float(su) / float(BoxSamples - 1));
+					p[v] = glm::mix(min[v], max[v], float(sv) / float(BoxSamples - 1));
+					float closest = std::numeric_limits< float >::infinity();
+					for (uint32_t i = 0; i + 2 < indices.size(); i += 3) {
+						glm::vec3 q = closest_point_on_triangle(p, positions[indices[i+0]], positions[indices[i+1]], positions[indices[i+2]]);
+						closest = std::min(closest, glm::length(q - p));
+					}
+					if (closest > max_error) return false;
+					worst = std::max(worst, closest);
+				}
+			}
+		}
+	}
+
+	//corner i has bit c set if it is at max[c]:
+	box_positions->clear();
+	for (uint32_t i = 0; i < 8; ++i) {
+		box_positions->emplace_back((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+	}
+	box_indices->clear();
+	for (uint32_t axis = 0; axis < 3; ++axis) {
+		uint32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
+		for (uint32_t side = 0; side < 2; ++side) {
+			uint32_t base = side << axis;
+			uint32_t q[4] = { base, base | (1U << u), base | (1U << u) | (1U << v), base | (1U << v) };
+			//(u, v, axis) is right-handed, so q is counterclockwise seen from the max side:
+			if (!side) std::swap(q[1], q[3]);
+			box_indices->insert(box_indices->end(), { q[0], q[1], q[2], q[0], q[2], q[3] });
+		}
+	}
+	if (worst_error) *worst_error = worst;
+	return true;
+}
+
+//simplify triangles (indices into positions) until the error bound is reached or only min_triangles remain:
+// returns the simplified triangles as indices into *positions (which may have moved).
+// if merged_into is given, it is set to the vertex each vertex was collapsed into (or the vertex itself).
+std::vector< uint32_t > simplify(std::vector< glm::vec3 > *positions_, std::vector< uint32_t > const &indices, float max_error, uint32_t min_triangles, float *worst_error, std::vector< uint32_t > *merged_into = nullptr) {
+	std::vector< glm::vec3 > &positions = *positions_;
+	uint32_t vertex_count = uint32_t(positions.size());
+
+	std::vector< std::array< uint32_t, 3 > > triangles;
+	for (uint32_t i = 0; i + 2 < indices.size(); i += 3) {
+		triangles.push_back({{ indices[i+0], indices[i+1], indices[i+2] }});
+	}
+	std::vector< bool > triangle_alive(triangles.size(), true);
+	uint32_t alive_count = uint32_t(triangles.size());
+	if (merged_into) {
+		merged_into->resize(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; ++v) (*merged_into)[v] = v;
+	}
+
+	auto triangle_normal = [&](std::array< uint32_t, 3 > const &t) -> glm::dvec3 {
+		glm::dvec3 a = positions[t[0]], b = positions[t[1]], c = positions[t[2]];
+		return glm::cross(b - a, c - a);
+	};
+
+	//vertex -> triangles (may contain dead triangles):
+	std::vector< std::vector< uint32_t > > vertex_triangles(vertex_count);
+	for (uint32_t t = 0; t < triangles.size(); ++t) {
+		for (uint32_t i = 0; i < 3; ++i) vertex_triangles[triangles[t][i]].emplace_back(t);
+	}
+
+	//quadrics from the planes of each vertex's triangles, plus planes along boundary edges:
+	std::vector< Quadric > quadrics(vertex_count);
+	std::map< std::pair< uint32_t, uint32_t >, uint32_t > edge_uses; //undirected edge -> triangles using it
+	for (auto const &t : triangles) {
+		glm::dvec3 n = triangle_normal(t);
+		double len = glm::length(n);
+		if (len == 0.0) continue;
+		n /= len;
+		Quadric q = Quadric::plane(n, -glm::dot(n, glm::dvec3(positions[t[0]])), 1.0);
+		for (uint32_t i = 0; i < 3; ++i) {
+			quadrics[t[i]] += q;
+			uint32_t a = t[i], b = t[(i+1)%3];
+			edge_uses[std::make_pair(std::min(a,b), std::max(a,b))] += 1;
+		}
+	}
+	for (auto const &t : triangles) {
+		glm::dvec3 n = triangle_normal(t);
+		double len = glm::length(n);
+		if (len == 0.0) continue;
+		n /= len;
+		for (uint32_t i = 0; i < 3; ++i) {
+			uint32_t a = t[i], b = t[(i+1)%3];
+			if (edge_uses[std::make_pair(std::min(a,b), std::max(a,b))] != 1) continue;
+			glm::dvec3 along = glm::dvec3(positions[b]) - glm::dvec3(positions[a]);
+			glm::dvec3 side = glm::cross(along, n);
+			double side_len = glm::length(side);
+			if (side_len == 0.0) continue;
+			side /= side_len;
+			Quadric q = Quadric::plane(side, -glm::dot(side, glm::dvec3(positions[a])), BoundaryWeight);
+			quadrics[a] += q;
+			quadrics[b] += q;
+		}
+	}
+
+	//pick where the vertex made by collapsing edge (a,b) goes:
+	// original positions are preferred when they are (nearly) as good, so flat regions and sharp corners stay exact.
+	auto plan_collapse = [&](uint32_t a, uint32_t b, glm::vec3 *target) -> double {
+		Quadric q = quadrics[a];
+		q += quadrics[b];
+		glm::dvec3 pa = positions[a], pb = positions[b];
+		double best = q.error(pa);
+		*target = positions[a];
+		double eb = q.error(pb);
+		if (eb < best) { best = eb; *target = positions[b]; }
+		glm::dvec3 pm = 0.5 * (pa + pb);
+		double em = q.error(pm);
+		glm::dvec3 po;
+		if (q.minimizer(&po)) {
+			double eo = q.error(po);
+			if (eo < em) { em = eo; pm = po; }
+		}
+		if (em < best - 1e-9 * (1.0 + best)) { best = em; *target = glm::vec3(pm); }
+		return std::max(0.0, best);
+	};
+
+	//version of each vertex (bumped when it changes, so queued collapses can be recognized as stale):
+	std::vector< uint32_t > version(vertex_count, 0);
+	std::vector< bool > vertex_alive(vertex_count, true);
+
+	struct Collapse {
+		double cost;
+		uint32_t a, b;
+		uint32_t version_a, version_b;
+		bool operator<(Collapse const &o) const { return cost > o.cost; } //(so priority_queue pops cheapest first)
+	};
+	std::priority_queue< Collapse > queue;
+	auto queue_collapse = [&](uint32_t a, uint32_t b) {
+		glm::vec3 target;
+		double cost = plan_collapse(a, b, &target);
+		queue.push(Collapse{cost, a, b, version[a], version[b]});
+	};
+	for (auto const &eu : edge_uses) {
+		queue_collapse(eu.first.first, eu.first.second);
+	}
+
+	double max_cost = double(max_error) * double(max_error);
+	double worst = 0.0;
+	std::vector< uint32_t > neighbors_a, neighbors_b, shared;
+	auto gather_neighbors = [&](uint32_t v, std::vector< uint32_t > *out) {
+		out->clear();
+		for (uint32_t t : vertex_triangles[v]) {
+			if (!triangle_alive[t]) continue;
+			for (uint32_t i = 0; i < 3; ++i) {
+				if (triangles[t][i] != v) out->emplace_back(triangles[t][i]);
+			}
+		}
+		std::sort(out->begin(), out->end());
+		out->erase(std::unique(out->begin(), out->end()), out->end());
+	};
+
+	while (!queue.empty() && alive_count > min_triangles) {
+		Collapse c = queue.top();
+		queue.pop();
+		if (!vertex_alive[c.a] || !vertex_alive[c.b]) continue;
+		if (version[c.a] != c.version_a || version[c.b] != c.version_b) continue;
+		if (c.cost > max_cost) break;
+
+		uint32_t a = c.a, b = c.b;
+
+		//triangles on the edge, and the vertices opposite it:
+		std::vector< uint32_t > edge_opposite;
+		for (uint32_t t : vertex_triangles[a]) {
+			if (!triangle_alive[t]) continue;
+			auto const &tri = triangles[t];
+			if (tri[0] != b && tri[1] != b && tri[2] != b) continue;
+			for (uint32_t i = 0; i < 3; ++i) {
+				if (tri[i] != a && tri[i] != b) edge_opposite.emplace_back(tri[i]);
+			}
+		}
+		if (edge_opposite.empty()) continue; //(edge no longer exists)
+		std::sort(edge_opposite.begin(), edge_opposite.end());
+
+		//link condition: the only vertices next to both ends are the ones opposite the edge:
+		gather_neighbors(a, &neighbors_a);
+		gather_neighbors(b, &neighbors_b);
+		shared.clear();
+		std::set_intersection(neighbors_a.begin(), neighbors_a.end(), neighbors_b.begin(), neighbors_b.end(), std::back_inserter(shared));
+		if (shared != edge_opposite) continue;
+
+		glm::vec3 target;
+		plan_collapse(a, b, &target);
+
+		//the triangles that remain must not flip or collapse:
+		bool flips = false;
+		for (uint32_t v : { a, b }) {
+			for (uint32_t t : vertex_triangles[v]) {
+				if (!triangle_alive[t]) continue;
+				auto tri = triangles[t];
+				if ((tri[0] == a || tri[1] == a || tri[2] == a) && (tri[0] == b || tri[1] == b || tri[2] == b)) continue;
+				glm::dvec3 before = triangle_normal(tri);
+				glm::vec3 old = positions[v];
+				positions[v] = target;
+				glm::dvec3 after = triangle_normal(tri);
+				positions[v] = old;
+				double lb = glm::length(before), la = glm::length(after);
+				if (la == 0.0 || (lb > 0.0 && glm::dot(before, after) < MinNormalDot * la * lb)) {
+					flips = true;
+					break;
+				}
+			}
+			if (flips) break;
+		}
+		if (flips) continue;
+
+		//collapse b into a:
+		worst = std::max(worst, c.cost);
+		positions[a] = target;
+		quadrics[a] += quadrics[b];
+		vertex_alive[b] = false;
+		if (merged_into) (*merged_into)[b] = a;
+		for (uint32_t t : vertex_triangles[b]) {
+			if (!triangle_alive[t]) continue;
+			auto &tri = triangles[t];
+			if (tri[0] == a || tri[1] == a || tri[2] == a) {
+				triangle_alive[t] = false;
+				alive_count -= 1;
+				continue;
+			}
+			for (uint32_t i = 0; i < 3; ++i) {
+				if (tri[i] == b) tri[i] = a;
+			}
+			vertex_triangles[a].emplace_back(t);
+		}
+		vertex_triangles[b].clear();
+		{ //drop dead triangles from a's list:
+			auto &list = vertex_triangles[a];
+			list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t){ return !triangle_alive[t]; }), list.end());
+		}
+
+		version[a] += 1;
+		gather_neighbors(a, &neighbors_a);
+		for (uint32_t n : neighbors_a) {
+			queue_collapse(std::min(a, n), std::max(a, n));
+		}
+	}
+
+	if (worst_error) *worst_error = float(std::sqrt(worst));
+
+	//(collapses chain, so point every vertex at the one it ended up in)
+	if (merged_into) {
+		for (uint32_t v = 0; v < vertex_count; ++v) {
+			uint32_t r = v;
+			while ((*merged_into)[r] != r) r = (*merged_into)[r];
+			(*merged_into)[v] = r;
+		}
+	}
+
+	std::vector< uint32_t > out;
+	for (uint32_t t = 0; t < triangles.size(); ++t) {
+		if (!triangle_alive[t]) continue;
+		out.insert(out.end(), triangles[t].begin(), triangles[t].end());
+	}
+	return out;
+}
+
+bool is_generated_name(std::string const &name) {
+	//levels of detail and colliders are made from other meshes, so don't get colliders or levels of their own:
+	return is_collider_name(name) || is_lod_name(name);
+}
+
+//weld a mesh's triangles by position (vertices that differ only in normal, color, etc. are the same point on the surface):
+// corners[i] is the vertex (in pnct.vertices) that became indices[i]; triangles that weld to nothing are dropped.
+void weld_mesh(PnctFile const &pnct, PnctFile::Mesh const &mesh, std::vector< glm::vec3 > *positions, std::vector< uint32_t > *indices, std::vector< uint32_t > *corners) {
+	positions->clear();
+	indices->clear();
+	corners->clear();
+	std::map< std::tuple< float, float, float >, uint32_t > position_index;
+	for (uint32_t i = mesh.vertex_begin; i + 2 < mesh.vertex_end; i += 3) {
+		uint32_t tri[3];
+		for (uint32_t j = 0; j < 3; ++j) {
+			glm::vec3 const &p = pnct.vertices[pnct.indices[i+j]].Position;
+			auto f = position_index.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z), uint32_t(positions->size())));
+			if (f.second) positions->emplace_back(p);
+			tri[j] = f.first->second;
+		}
+		if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) continue;
+		indices->insert(indices->end(), tri, tri + 3);
+		for (uint32_t j = 0; j < 3; ++j) corners->emplace_back(pnct.indices[i+j]);
+	}
+}
+
+//make a collider for a mesh (as above); returns the collider's vertices, as triangles:
+std::vector< PnctFile::Vertex > make_collider(PnctFile const &pnct, PnctFile::Mesh const &mesh, float max_error) {
+	std::vector< glm::vec3 > positions;
+	std::vector< uint32_t > indices, corners;
+	weld_mesh(pnct, mesh, &positions, &indices, &corners);
+
+	float worst_error = 0.0f;
+	std::vector< glm::vec3 > box_positions;
+	std::vector< uint32_t > simplified;
+	bool is_box = fit_box(positions, indices, max_error, &box_positions, &simplified, &worst_error);
+	if (is_box) {
+		positions = box_positions;
+	} else {
+		simplified = simplify(&positions, indices, max_error, 0, &worst_error);
+	}
+
+	//(flat-shaded, so it is easy to look at in show-meshes)
+	std::vector< PnctFile::Vertex > out;
+	for (uint32_t i = 0; i + 2 < simplified.size(); i += 3) {
+		glm::vec3 const &a = positions[simplified[i+0]];
+		glm::vec3 const &b = positions[simplified[i+1]];
+		glm::vec3 const &c = positions[simplified[i+2]];
+		glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+		for (glm::vec3 const &p : { a, b, c }) {
+			PnctFile::Vertex v;
+			v.Position = p;
+			v.Normal = normal;
+			v.Color = glm::u8vec4(0xff);
+			v.TexCoord = glm::vec2(0.0f);
+			out.emplace_back(v);
+		}
+	}
+
+	std::cout << "  " << std::left << std::setw(24) << mesh.name << std::right
+		<< " " << std::setw(5) << indices.size() / 3 << " -> " << std::setw(5) << simplified.size() / 3 << " triangles"
+		<< "   (" << (is_box ? "box, " : "") << "worst error " << worst_error << ")\n";
+	return out;
+}
+
+//make levels of detail for a mesh (as above); returns each level's vertices, as triangles:
+std::vector< std::vector< PnctFile::Vertex > > make_lods(PnctFile const &pnct, PnctFile::Mesh const &mesh, std::vector< float > const &fractions) {
+	std::vector< glm::vec3 > positions;
+	std::vector< uint32_t > indices, corners;
+	weld_mesh(pnct, mesh, &positions, &indices, &corners);
+
+	//attributes of each welded position, summed over the corners there:
+	struct Attributes {
+		glm::vec3 normal = glm::vec3(0.0f);
+		glm::vec4 color = glm::vec4(0.0f);
+		glm::vec2 tex_coord = glm::vec2(0.0f);
+		float count = 0.0f;
+		bool smooth = true; //all corners had the same normal
+		glm::vec3 first_normal = glm::vec3(0.0f);
+	};
+	std::vector< Attributes > attributes(positions.size());
+	for (uint32_t i = 0; i < indices.size(); ++i) {
+		PnctFile::Vertex const &v = pnct.vertices[corners[i]];
+		Attributes &attr = attributes[indices[i]];
+		if (attr.count == 0.0f) attr.first_normal = v.Normal;
+		else if (v.Normal != attr.first_normal) attr.smooth = false;
+		attr.normal += v.Normal;
+		attr.color += glm::vec4(v.Color);
+		attr.tex_coord += v.TexCoord;
+		attr.count += 1.0f;
+	}
+
+	std::vector< std::vector< PnctFile::Vertex > > levels;
+	uint32_t previous = uint32_t(indices.size() / 3);
+	std::cout << "  " << std::left << std::setw(24) << mesh.name << std::right << " " << std::setw(5) << previous << " triangles";
+	for (float fraction : fractions) {
+		std::vector< glm::vec3 > lod_positions = positions;
+		std::vector< uint32_t > merged_into;
+		uint32_t target = uint32_t(std::ceil(fraction * float(indices.size() / 3)));
+		std::vector< uint32_t > simplified = simplify(&lod_positions, indices, std::numeric_limits< float >::infinity(), target, nullptr, &merged_into);
+		uint32_t triangles = uint32_t(simplified.size() / 3);
+		if (!(float(triangles) < MaxLODFraction * float(previous))) {
+			std::cout << " -> (" << triangles << ", skipped)";
+			break; //(simplifying further won't get any closer)
+		}
+		previous = triangles;
+
+		//each surviving vertex gets the attributes of all the vertices collapsed into it:
+		std::vector< Attributes > merged(positions.size());
+		for (uint32_t v = 0; v < positions.size(); ++v) {
+			Attributes &to = merged[merged_into[v]];
+			Attributes const &from = attributes[v];
+			to.normal += from.normal;
+			to.color += from.color;
+			to.tex_coord += from.tex_coord;
+			to.count += from.count;
+			to.smooth = to.smooth && from.smooth;
+		}
+
+		levels.emplace_back();
+		for (uint32_t i = 0; i + 2 < simplified.size(); i += 3) {
+			glm::vec3 const &a = lod_positions[simplified[i+0]];
+			glm::vec3 const &b = lod_positions[simplified[i+1]];
+			glm::vec3 const &c = lod_positions[simplified[i+2]];
+			glm::vec3 face_normal = glm::normalize(glm::cross(b - a, c - a));
+			for (uint32_t j = 0; j < 3; ++j) {
+				Attributes const &attr = merged[simplified[i+j]];
+				PnctFile::Vertex v;
+				v.Position = lod_positions[simplified[i+j]];
+				v.Normal = (attr.smooth && glm::length(attr.normal) > 0.0f ? glm::normalize(attr.normal) : face_normal);
+				v.Color = glm::u8vec4(glm::round(glm::clamp(attr.color / attr.count, glm::vec4(0.0f), glm::vec4(255.0f))));
+				v.TexCoord = attr.tex_coord / attr.count;
+				levels.back().emplace_back(v);
+			}
+		}
+		std::cout << " -> " << triangles;
+	}
+	std::cout << "\n";
+	return levels;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	try { //windows doesn't print nice errors for unhandled exceptions, so we need to.
+#endif
+	bool lods = (argc >= 2 && std::string(argv[1]) == "--lods");
+	if (lods) {
+		argc -= 1;
+		argv += 1;
+	}
+	if (argc < 3 || (lods && argc < 4)) {
+		std::cerr << "Usage:\n\t./simplify-colliders <in.pnct> <out.pnct> [max-error] [mesh ...]\n";
+		std::cerr << " will add a simplified \"<name>.Collider\" mesh for each named mesh (default: all meshes) in \"in.pnct\" and write the result to \"out.pnct\".\n";
+		std::cerr << " vertices of the simplified meshes stay within max-error (default: " << DefaultMaxError << ") of the original surfaces' planes.\n";
+		std::cerr << "\t./simplify-colliders --lods <in.pnct> <out.pnct> <fraction,...> [mesh ...]\n";
+		std::cerr << " will add \"<name>.LOD1\", \"<name>.LOD2\", ... meshes with those fractions (e.g., '0.25,0.06') of the triangles of each named mesh (default: all meshes).\n";
+		std::cerr.flush();
+		return 1;
+	}
+	std::string in_file = argv[1];
+	std::string out_file = argv[2];
+	float max_error = DefaultMaxError;
+	std::vector< float > fractions;
+	if (lods) {
+		std::string list = argv[3];
+		for (std::string::size_type begin = 0; begin <= list.size(); ) {
+			std::string::size_type end = list.find(',', begin);
+			if (end == std::string::npos) end = list.size();
+			fractions.emplace_back(std::stof(list.substr(begin, end - begin)));
+			if (!(fractions.back() > 0.0f && fractions.back() < 1.0f)) throw std::runtime_error("Level of detail fractions must be between zero and one.");
+			if (fractions.size() > 1 && !(fractions.back() < fractions[fractions.size()-2])) throw std::runtime_error("Level of detail fractions must decrease.");
+			begin = end + 1;
+		}
+	} else if (argc >= 4) {
+		max_error = std::stof(argv[3]);
+		if (!(max_error >= 0.0f)) throw std::runtime_error("Error bound must be non-negative.");
+	}
+	std::set< std::string > names;
+	for (int a = 4; a < argc; ++a) {
+		names.insert(argv[a]);
+	}
+
+	PnctFile pnct;
+	load_pnct(in_file, &pnct);
+	index_pnct(&pnct);
+
+	for (auto const &name : names) {
+		if (std::find_if(pnct.meshes.begin(), pnct.meshes.end(), [&](PnctFile::Mesh const &m){ return m.name == name; }) == pnct.meshes.end()) {
+			throw std::runtime_error("Mesh '" + name + "' isn't in '" + in_file + "'.");
+		}
+	}
+
+	//meshes to make colliders or levels of detail for:
+	std::set< std::string > sources;
+	for (auto const &mesh : pnct.meshes) {
+		if (names.empty() ? is_generated_name(mesh.name) : !names.count(mesh.name)) continue;
+		if ((mesh.vertex_end - mesh.vertex_begin) % 3 != 0) {
+			std::cerr << "WARNING: mesh '" << mesh.name << "' isn't a list of triangles; skipping it." << std::endl;
+			continue;
+		}
+		sources.insert(mesh.name);
+	}
+
+	//colliders from an earlier run are replaced, as are earlier levels of detail of the meshes being simplified:
+	pnct.meshes.erase(std::remove_if(pnct.meshes.begin(), pnct.meshes.end(), [&](PnctFile::Mesh const &m){
+		if (!lods) return is_collider_name(m.name);
+		std::string base;
+		return is_lod_name(m.name, &base) && sources.count(base) != 0;
+	}), pnct.meshes.end());
+
+	if (lods) {
+		std::cout << "Simplifying levels of detail in '" << in_file << "':\n";
+	} else {
+		std::cout << "Simplifying colliders in '" << in_file << "' (error bound " << max_error << "):\n";
+	}
+	std::cout << std::fixed << std::setprecision(4);
+	std::vector< PnctFile::Mesh > added;
+	auto add_mesh = [&](std::string const &name, std::vector< PnctFile::Vertex > const &vertices) {
+		PnctFile::Mesh mesh;
+		mesh.name = name;
+		mesh.vertex_begin = uint32_t(pnct.indices.size());
+		for (auto const &v : vertices) {
+			pnct.indices.emplace_back(uint32_t(pnct.vertices.size()));
+			pnct.vertices.emplace_back(v);
+		}
+		mesh.vertex_end = uint32_t(pnct.indices.size());
+		added.emplace_back(mesh);
+	};
+	for (uint32_t m = 0; m < pnct.meshes.size(); ++m) {
+		PnctFile::Mesh const mesh = pnct.meshes[m]; //(copied, since add_mesh grows pnct)
+		if (!sources.count(mesh.name)) continue;
+		if (lods) {
+			std::vector< std::vector< PnctFile::Vertex > > levels = make_lods(pnct, mesh, fractions);
+			for (uint32_t l = 0; l < levels.size(); ++l) {
+				add_mesh(mesh.name + ".LOD" + std::to_string(l + 1), levels[l]);
+			}
+		} else {
+			add_mesh(mesh.name + ".Collider", make_collider(pnct, mesh, max_error));
+		}
+	}
+	std::cout << std::defaultfloat;
+	pnct.meshes.insert(pnct.meshes.end(), added.begin(), added.end());
+
+	//rebuild the file from the meshes' ranges, which merges the new vertices with existing ones
+	// and drops anything no longer used (e.g., replaced colliders):
+	{
+		PnctFile merged;
+		merged.vertices.reserve(pnct.indices.size());
+		for (auto const &mesh : pnct.meshes) {
+			merged.meshes.emplace_back(mesh);
+			merged.meshes.back().vertex_begin = uint32_t(merged.vertices.size());
+			for (uint32_t i = mesh.vertex_begin; i < mesh.vertex_end; ++i) {
+				merged.vertices.emplace_back(pnct.vertices[pnct.indices[i]]);
+			}
+			merged.meshes.back().vertex_end = uint32_t(merged.vertices.size());
+		}
+		index_pnct(&merged);
+		pnct = std::move(merged);
+	}
+
+	save_pnct(out_file, pnct);
+	std::cout << "Wrote '" << out_file << "': " << pnct.vertices.size() << " vertices, " << pnct.indices.size() << " indices, " << pnct.meshes.size() << " meshes." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}